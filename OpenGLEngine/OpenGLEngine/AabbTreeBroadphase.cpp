@@ -0,0 +1,95 @@
+#include "AabbTreeBroadphase.h"
+#include <algorithm>
+
+namespace Reality
+{
+	void AabbTreeBroadphase::Update(const std::vector<BroadphaseSphere>& _spheres)
+	{
+		frame++;
+		spheres = _spheres;
+
+		for (uint32_t i = 0; i < spheres.size(); i++)
+		{
+			const auto& sphere = spheres[i];
+			if (sphere.id >= bodies.size())
+			{
+				bodies.resize(sphere.id + 1);
+			}
+
+			auto& body = bodies[sphere.id];
+			if (body.proxy == DynamicAabbTree::NullNode)
+			{
+				body.proxy = tree.CreateProxy(GetBounds(sphere), sphere.id);
+			}
+			else
+			{
+				tree.MoveProxy(body.proxy, GetBounds(sphere), sphere.position - body.position);
+			}
+			body.sphere = i;
+			body.frame = frame;
+			body.position = sphere.position;
+		}
+
+		// Bodies that weren't in this update are gone
+		for (auto& body : bodies)
+		{
+			if (body.proxy != DynamicAabbTree::NullNode && body.frame != frame)
+			{
+				tree.DestroyProxy(body.proxy);
+				body.proxy = DynamicAabbTree::NullNode;
+			}
+		}
+	}
+
+	void AabbTreeBroadphase::FindPairs(std::vector<BroadphasePair>& pairs) const
+	{
+		const auto first = pairs.size();
+		tree.QueryPairs([&](int32_t proxyA, int32_t proxyB) {
+			// The leaves are fattened, keep the pairs whose tight boxes overlap too
+			const auto a = bodies[tree.GetId(proxyA)].sphere;
+			const auto b = bodies[tree.GetId(proxyB)].sphere;
+			if (GetBounds(spheres[a]).Overlaps(GetBounds(spheres[b])))
+			{
+				pairs.emplace_back(std::min(a, b), std::max(a, b));
+			}
+		});
+
+		std::sort(pairs.begin() + first, pairs.end());
+	}
+
+	void AabbTreeBroadphase::QueryOverlaps(const Aabb& box, std::vector<unsigned int>& result) const
+	{
+		tree.Query(box, [&](int32_t proxy) {
+			const auto sphere = bodies[tree.GetId(proxy)].sphere;
+			if (box.Overlaps(GetBounds(spheres[sphere])))
+			{
+				result.push_back(sphere);
+			}
+			return true;
+		});
+	}
+
+	bool AabbTreeBroadphase::RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, unsigned int& sphere, float& distance) const
+	{
+		bool hit = false;
+		tree.RayCast(origin, direction, maxDistance, [&](int32_t proxy, float) {
+			// The closest hit so far clips the ray
+			const auto index = bodies[tree.GetId(proxy)].sphere;
+			float t;
+			if (RayCastSphere(spheres[index], origin, direction, maxDistance, t))
+			{
+				maxDistance = t;
+				sphere = index;
+				distance = t;
+				hit = true;
+			}
+			return maxDistance;
+		});
+		return hit;
+	}
+
+	Aabb AabbTreeBroadphase::GetBounds(const BroadphaseSphere& sphere)
+	{
+		return Aabb(sphere.position - Vector3(sphere.radius), sphere.position + Vector3(sphere.radius));
+	}
+}
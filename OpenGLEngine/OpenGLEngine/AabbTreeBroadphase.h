@@ -0,0 +1,48 @@
+#pragma once
+#include "SphereBroadphase.h"
+#include "DynamicAabbTree.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Broadphase on a dynamic AABB tree with one leaf per body, kept from one step to the next by sphere id. The tree
+		doesn't care how different the spheres' sizes are, unlike a grid whose cells have to fit the largest one.
+
+		Between updates the tree also answers overlap and ray queries, so finding what is near a point or under the
+		cursor doesn't need a loop over every body.
+	*/
+	class AabbTreeBroadphase : public SphereBroadphase
+	{
+	public:
+		void Update(const std::vector<BroadphaseSphere>& spheres) override;
+
+		void FindPairs(std::vector<BroadphasePair>& pairs) const override;
+
+		// Appends the indices of the last update's spheres whose bounding boxes overlap the box
+		void QueryOverlaps(const Aabb& box, std::vector<unsigned int>& result) const;
+
+		// Closest of the last update's spheres the ray hits within maxDistance, direction has to be normalized
+		bool RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, unsigned int& sphere, float& distance) const;
+
+		const DynamicAabbTree& GetTree() const { return tree; }
+
+	private:
+		struct Body
+		{
+			int32_t proxy = DynamicAabbTree::NullNode;
+			uint32_t sphere = 0;
+			uint32_t frame = 0;
+			Vector3 position = Vector3(0, 0, 0);
+		};
+
+		static Aabb GetBounds(const BroadphaseSphere& sphere);
+
+		DynamicAabbTree tree;
+		// index = sphere id
+		std::vector<Body> bodies;
+		std::vector<BroadphaseSphere> spheres;
+		uint32_t frame = 0;
+	};
+}
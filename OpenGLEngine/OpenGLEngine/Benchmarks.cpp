@@ -0,0 +1,709 @@
+#include "Benchmarks.h"
+#include "ECSConfig.h"
+#include "TransformComponent.h"
+#include "ParticleComponent.h"
+#include "PairedSpringComponent.h"
+#include "RodComponent.h"
+#include "ParticleSystem.h"
+#include "GravityForceGeneratorSystem.h"
+#include "ForceAccumulatorSystem.h"
+#include "ParticleIntegrationSystem.h"
+#include "SpringNetworkSystem.h"
+#include "DistanceConstraintSystem.h"
+#include "SpatialHashGrid.h"
+#include "SweepAndPrune.h"
+#include "AabbTreeBroadphase.h"
+#include "SphereNarrowphase.h"
+#include "InputEventSystem.h"
+#include "FPSControlSystem.h"
+#include "RotateSystem.h"
+#include "ParticleSpawnerSystem.h"
+#include "BuoyancyForceGeneratorSystem.h"
+#include "SphereContactGeneratorSystem.h"
+#include "ParticleContactResolutionSystem.h"
+#include "ParticleSleepSystem.h"
+#include "DynamicDirectionalLightSystem.h"
+#include "DynamicPointLightSystem.h"
+#include "DynamicSpotLightSystem.h"
+#include "RenderingSystem.h"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cassert>
+
+namespace Reality
+{
+	namespace
+	{
+		float RandomFloat(float low, float high)
+		{
+			return low + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (high - low)));
+		}
+
+		// Milliseconds one call of fn takes, averaged over runs calls
+		template<typename Fn>
+		double TimeMilliseconds(int runs, Fn fn)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int run = 0; run < runs; run++)
+			{
+				fn();
+			}
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / runs;
+		}
+
+		// Calls fn(name) with the kernel set to each SIMD level the CPU supports, scalar first
+		template<typename Kernel, typename Fn>
+		void ForEachSimdLevel(Kernel& kernel, Fn fn)
+		{
+			for (auto level : { SimdLevel::Scalar, SimdLevel::Sse, SimdLevel::Avx2 })
+			{
+				kernel.SetSimdLevel(level);
+				if (kernel.GetSimdLevel() == level)
+				{
+					fn(GetSimdLevelName(level));
+				}
+			}
+		}
+
+		// A square of cloth hanging from its top row, with structural and shear springs
+		std::vector<ECSEntity> MakeCloth(ECSWorld& world, int side, float springConstant, int& springCount)
+		{
+			std::vector<ECSEntity> particles;
+			for (int y = 0; y < side; y++)
+			{
+				for (int x = 0; x < side; x++)
+				{
+					auto e = world.createEntity();
+					e.addComponent<TransformComponent>(Vector3(x * 0.5f, 100.0f, y * 0.5f));
+					e.addComponent<ParticleComponent>(y == 0 ? INFINITY : 1.0f);
+					particles.push_back(e);
+				}
+			}
+			springCount = 0;
+			auto connect = [&](int x1, int y1, int x2, int y2)
+			{
+				if (x2 < 0 || x2 >= side || y2 >= side)
+				{
+					return;
+				}
+				auto spring = world.createEntity();
+				const float restLength = 0.5f * std::sqrt((float)((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)));
+				spring.addComponent<PairedSpringComponent>(springConstant, restLength, particles[y1 * side + x1], particles[y2 * side + x2]);
+				springCount++;
+			};
+			for (int y = 0; y < side; y++)
+			{
+				for (int x = 0; x < side; x++)
+				{
+					connect(x, y, x + 1, y);
+					connect(x, y, x, y + 1);
+					connect(x, y, x + 1, y + 1);
+					connect(x, y, x - 1, y + 1);
+				}
+			}
+			return particles;
+		}
+
+		// How far a unit spring oscillator (acceleration -x) is from cos(t) after duration, stepped with the method.
+		// Position and velocity together, the position alone hides the phase error at the turning points.
+		template<typename Method>
+		float OscillatorError(float deltaTime, float duration)
+		{
+			Vector3 position(1, 0, 0);
+			Vector3 velocity(0, 0, 0);
+			auto spring = [](const Vector3& position, const Vector3& velocity) { return -position; };
+			const int steps = (int)std::round(duration / deltaTime);
+			for (int step = 0; step < steps; step++)
+			{
+				Method::Step(position, velocity, spring, deltaTime);
+			}
+			const float time = steps * deltaTime;
+			const float positionError = position.x - std::cos(time);
+			const float velocityError = velocity.x + std::sin(time);
+			return std::sqrt(positionError * positionError + velocityError * velocityError);
+		}
+
+		// How the sphere broadphases scale with the number of spheres
+		void BenchmarkSphereBroadphase()
+		{
+			// Same density at every size, so the number of contacts per sphere stays about the same
+			const int counts[] = { 1000, 2000, 5000, 10000, 20000 };
+			std::vector<BroadphaseSphere> spheres;
+			std::vector<Vector3> start;
+			std::vector<Vector3> velocities;
+			std::vector<BroadphasePair> pairs;
+			auto overlaps = [&spheres](unsigned int a, unsigned int b)
+			{
+				Vector3 delta = spheres[a].position - spheres[b].position;
+				float radii = spheres[a].radius + spheres[b].radius;
+				return glm::dot(delta, delta) < radii * radii;
+			};
+
+			// Every broadphase sees the same steps, the spheres move a little each step like they would in the scene
+			const int steps = 10;
+			auto move = [&](int step)
+			{
+				for (size_t i = 0; i < spheres.size(); i++)
+				{
+					spheres[i].position = start[i] + (float)step * velocities[i];
+				}
+			};
+			auto run = [&](SphereBroadphase& broadphase, int& contacts)
+			{
+				// The first update isn't timed, it is where sweep and prune sorts everything from scratch
+				move(0);
+				broadphase.Update(spheres);
+				int step = 0;
+				return TimeMilliseconds(steps, [&]()
+				{
+					move(++step);
+					contacts = 0;
+					pairs.clear();
+					broadphase.Update(spheres);
+					broadphase.FindPairs(pairs);
+					for (const auto& pair : pairs)
+					{
+						contacts += overlaps(pair.a, pair.b) ? 1 : 0;
+					}
+				});
+			};
+
+			// Spheres of about the same size, then with one in a hundred much larger, which makes the grid's cells that large
+			for (int mixed = 0; mixed < 2; mixed++)
+			{
+				std::cout << (mixed ? "mixed sizes" : "similar sizes") << std::endl;
+				std::cout << "spheres | grid ms | sweep and prune ms | aabb tree ms | brute force ms | contacts (grid / sweep and prune / aabb tree / brute force)" << std::endl;
+				for (int count : counts)
+				{
+					float halfSize = 0.5f * cbrt(8.0f * count);
+					spheres.clear();
+					start.clear();
+					velocities.clear();
+					for (int i = 0; i < count; i++)
+					{
+						start.push_back(Vector3(RandomFloat(-halfSize, halfSize), RandomFloat(-halfSize, halfSize), RandomFloat(-halfSize, halfSize)));
+						velocities.push_back(Vector3(RandomFloat(-0.05f, 0.05f), RandomFloat(-0.05f, 0.05f), RandomFloat(-0.05f, 0.05f)));
+						spheres.emplace_back(start[i], mixed && i % 100 == 0 ? 15.0f : RandomFloat(0.5f, 1.0f), i);
+					}
+
+					SpatialHashGrid grid;
+					SweepAndPrune sweepAndPrune;
+					AabbTreeBroadphase aabbTree;
+					int gridContacts = 0;
+					int sweepAndPruneContacts = 0;
+					int aabbTreeContacts = 0;
+					auto gridTime = run(grid, gridContacts);
+					auto sweepAndPruneTime = run(sweepAndPrune, sweepAndPruneContacts);
+					auto aabbTreeTime = run(aabbTree, aabbTreeContacts);
+
+					// Brute force only for the last step
+					int bruteForceContacts = 0;
+					auto bruteForceTime = TimeMilliseconds(1, [&]()
+					{
+						for (int i = 0; i < count; i++)
+						{
+							for (int j = i + 1; j < count; j++)
+							{
+								bruteForceContacts += overlaps(i, j) ? 1 : 0;
+							}
+						}
+					});
+
+					std::cout << count << " | " << gridTime << " | " << sweepAndPruneTime << " | " << aabbTreeTime << " | " << bruteForceTime << " | " <<
+						gridContacts << " / " << sweepAndPruneContacts << " / " << aabbTreeContacts << " / " << bruteForceContacts << std::endl;
+				}
+			}
+		}
+
+		// How fast each SIMD level tests sphere pairs, and how far they are from the scalar results
+		void BenchmarkSphereNarrowphase()
+		{
+			// Candidate pairs like a broadphase hands over each step, about one in four of them touching
+			const int pairCount = 20000;
+			std::vector<BroadphaseSphere> spheres;
+			std::vector<BroadphasePair> pairs;
+			for (int i = 0; i < pairCount; i++)
+			{
+				Vector3 position(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+				Vector3 offset(RandomFloat(-2.0f, 2.0f), RandomFloat(-2.0f, 2.0f), RandomFloat(-2.0f, 2.0f));
+				spheres.emplace_back(position, RandomFloat(0.5f, 1.0f));
+				spheres.emplace_back(position + offset, RandomFloat(0.5f, 1.0f));
+				pairs.emplace_back(2 * i, 2 * i + 1);
+			}
+
+			SphereNarrowphase narrowphase;
+			std::vector<SphereContactRecord> contacts;
+			auto time = TimeMilliseconds(500, [&]()
+			{
+				contacts.clear();
+				narrowphase.Collide(spheres, pairs, contacts);
+			});
+			std::cout << pairCount << " pairs | " << time << " ms | " << contacts.size() << " contacts" << std::endl;
+		}
+
+		// How the fused particle integration compares to the separate gravity, accumulator and particle systems
+		void BenchmarkParticleIntegration()
+		{
+			const int count = 1000000;
+			const int steps = 20;
+			const float deltaTime = 1 / 60.0f;
+
+			// Same particles in both worlds, one integrated by the separate systems and one by the fused one
+			ECSWorld separateWorld;
+			separateWorld.getSystemManager().addSystem<GravityForceGeneratorSystem>();
+			separateWorld.getSystemManager().addSystem<ForceAccumulatorSystem>();
+			separateWorld.getSystemManager().addSystem<ParticleSystem>();
+			ECSWorld fusedWorld;
+			fusedWorld.getSystemManager().addSystem<ParticleIntegrationSystem>();
+			for (int i = 0; i < count; i++)
+			{
+				Vector3 position(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f));
+				Vector3 velocity(RandomFloat(-5.0f, 5.0f), RandomFloat(-5.0f, 5.0f), RandomFloat(-5.0f, 5.0f));
+				float mass = RandomFloat(0.5f, 5.0f);
+				for (auto world : { &separateWorld, &fusedWorld })
+				{
+					auto e = world->createEntity();
+					e.addComponent<TransformComponent>(position);
+					e.addComponent<ParticleComponent>(mass, velocity);
+				}
+			}
+			separateWorld.update();
+			fusedWorld.update();
+
+			auto& gravity = separateWorld.getSystemManager().getSystem<GravityForceGeneratorSystem>();
+			auto& accumulator = separateWorld.getSystemManager().getSystem<ForceAccumulatorSystem>();
+			auto& particles = separateWorld.getSystemManager().getSystem<ParticleSystem>();
+			auto& fused = fusedWorld.getSystemManager().getSystem<ParticleIntegrationSystem>();
+
+			auto separateTime = TimeMilliseconds(steps, [&]()
+			{
+				gravity.Update(deltaTime);
+				accumulator.Update(deltaTime);
+				particles.Update(deltaTime);
+			});
+			auto fusedTime = TimeMilliseconds(steps, [&]() { fused.Update(deltaTime); });
+
+			// Gravity goes through the force in the separate systems, so the two only agree up to rounding
+			float difference = 0;
+			const auto separateEntities = particles.getEntities();
+			const auto fusedEntities = fused.getEntities();
+			for (size_t i = 0; i < separateEntities.size(); i++)
+			{
+				difference = std::max(difference, glm::length(separateEntities[i].getComponent<TransformComponent>().position -
+					fusedEntities[i].getComponent<TransformComponent>().position));
+			}
+
+			std::cout << count << " particles, ms per step" << std::endl;
+			std::cout << "separate systems | " << separateTime << std::endl;
+			std::cout << "fused system | " << fusedTime << " | largest difference " << difference << std::endl;
+		}
+
+		// How long the spring network takes for a cloth of about 100k springs, and each SIMD level's kernel
+		void BenchmarkSpringNetwork()
+		{
+			// About 100k springs
+			const int side = 160;
+			const int steps = 50;
+			const float deltaTime = 1 / 60.0f;
+
+			ECSWorld world;
+			world.getSystemManager().addSystem<SpringNetworkSystem>();
+			world.getSystemManager().addSystem<ParticleIntegrationSystem>();
+			int springCount = 0;
+			auto particles = MakeCloth(world, side, 500.0f, springCount);
+			world.update();
+
+			// The generator systems draw every spring, so they can't run without a window. This one is timed without drawing.
+			auto& springs = world.getSystemManager().getSystem<SpringNetworkSystem>();
+			auto& integration = world.getSystemManager().getSystem<ParticleIntegrationSystem>();
+			springs.drawSprings = false;
+			springs.Update(deltaTime);
+			integration.Update(deltaTime);
+
+			auto stepTime = TimeMilliseconds(steps, [&]()
+			{
+				springs.Update(deltaTime);
+				integration.Update(deltaTime);
+			});
+			auto springTime = TimeMilliseconds(steps, [&]() { springs.Update(deltaTime); });
+
+			std::cout << springCount << " springs, " << particles.size() << " particles, " << springs.GetRebuildCount() << " rebuilds" << std::endl;
+			std::cout << "springs | " << springTime << " ms" << std::endl;
+			std::cout << "springs + integration | " << stepTime << " ms" << std::endl;
+
+			// The force kernel alone, and how far each level is from the scalar forces
+			auto& network = springs.GetNetwork();
+			network.SetSimdLevel(SimdLevel::Scalar);
+			network.ComputeForces(0, network.GetSpringCount());
+			std::vector<Vector3> reference;
+			for (uint32_t node = 0; node < network.GetNodeCount(); node++)
+			{
+				reference.push_back(network.GetNodeForce(node));
+			}
+
+			std::cout << "kernel level | ms | largest difference from scalar" << std::endl;
+			ForEachSimdLevel(network, [&](const char* name)
+			{
+				auto time = TimeMilliseconds(steps, [&]() { network.ComputeForces(0, network.GetSpringCount()); });
+
+				float difference = 0;
+				for (uint32_t node = 0; node < network.GetNodeCount(); node++)
+				{
+					difference = std::max(difference, glm::length(network.GetNodeForce(node) - reference[node]));
+				}
+				std::cout << name << " | " << time << " | " << difference << std::endl;
+			});
+		}
+
+		// How stiff cloth fares with explicit steps, explicit substeps and one implicit step per frame
+		void BenchmarkImplicitSprings()
+		{
+			// Stiff enough that explicit steps of 1/60 blow up
+			const int side = 100;
+			const float springConstant = 50000.0f;
+			const int frames = 120;
+			const float frameTime = 1 / 60.0f;
+
+			auto run = [&](const char* name, bool implicit, int substeps)
+			{
+				ECSWorld world;
+				world.getSystemManager().addSystem<SpringNetworkSystem>();
+				world.getSystemManager().addSystem<ParticleIntegrationSystem>();
+				int springCount = 0;
+				auto particles = MakeCloth(world, side, springConstant, springCount);
+				world.update();
+
+				auto& springs = world.getSystemManager().getSystem<SpringNetworkSystem>();
+				auto& integration = world.getSystemManager().getSystem<ParticleIntegrationSystem>();
+				springs.drawSprings = false;
+				springs.implicitIntegration = implicit;
+
+				int iterations = 0;
+				auto time = TimeMilliseconds(frames, [&]()
+				{
+					for (int substep = 0; substep < substeps; substep++)
+					{
+						springs.Update(frameTime / substeps);
+						integration.Update(frameTime / substeps);
+						iterations += springs.GetImplicitSolver().GetIterations();
+					}
+				});
+
+				// NaN and infinity if it blew up
+				float maxSpeed = 0;
+				float lowest = INFINITY;
+				for (auto e : particles)
+				{
+					const float speed = glm::length(e.getComponent<ParticleComponent>().velocity);
+					maxSpeed = std::isfinite(speed) ? std::max(maxSpeed, speed) : INFINITY;
+					lowest = std::min(lowest, e.getComponent<TransformComponent>().position.y);
+				}
+				std::cout << name << " | " << time << " | " << maxSpeed << " | " << lowest << " | " <<
+					(implicit ? (float)iterations / (frames * substeps) : 0.0f) << std::endl;
+			};
+
+			std::cout << "cloth of " << side * side << " particles, spring constant " << springConstant << ", " << frames << " frames" << std::endl;
+			std::cout << "method | ms per frame | fastest particle | lowest particle | CG iterations per step" << std::endl;
+			run("explicit, 1 step", false, 1);
+			run("explicit, 4 substeps", false, 4);
+			run("explicit, 8 substeps", false, 8);
+			run("explicit, 16 substeps", false, 16);
+			run("implicit, 1 step", true, 1);
+		}
+
+		// How long a hanging chain of 10k rods takes per step, and how far its links are from their length
+		// Chains of rods hanging from fixed points, started sideways so they swing down. Prints the cost per step and
+		// the largest length error relative to the link's length for each number of substeps and iterations.
+		void BenchmarkChains(int chains, int links, std::initializer_list<int> substepCounts, std::initializer_list<int> iterationCounts,
+			float maxRelativeError)
+		{
+			const float linkLength = 0.1f;
+			const int frames = 120;
+			const float deltaTime = 1 / 60.0f;
+
+			ECSWorld world;
+			world.getSystemManager().addSystem<ParticleIntegrationSystem>();
+			world.getSystemManager().addSystem<DistanceConstraintSystem>();
+			std::vector<ECSEntity> particles;
+			std::vector<Vector3> startPositions;
+			for (int chain = 0; chain < chains; chain++)
+			{
+				auto previous = world.createEntity();
+				previous.addComponent<TransformComponent>(Vector3(0, 1000, chain));
+				for (int i = 1; i <= links; i++)
+				{
+					startPositions.push_back(Vector3(i * linkLength, 1000, chain));
+					auto e = world.createEntity();
+					e.addComponent<TransformComponent>(startPositions.back());
+					e.addComponent<ParticleComponent>(1.0f);
+					auto rod = world.createEntity();
+					rod.addComponent<RodComponent>(previous, e, linkLength);
+					particles.push_back(e);
+					previous = e;
+				}
+			}
+			world.update();
+
+			auto& integration = world.getSystemManager().getSystem<ParticleIntegrationSystem>();
+			auto& constraints = world.getSystemManager().getSystem<DistanceConstraintSystem>();
+			constraints.drawConstraints = false;
+
+			std::cout << chains << " chains of " << links << " links, " << frames << " frames" << std::endl;
+			std::cout << "substeps | iterations | ms per step | largest relative length error" << std::endl;
+			for (int substeps : substepCounts)
+			{
+				for (int iterations : iterationCounts)
+				{
+					for (size_t i = 0; i < particles.size(); i++)
+					{
+						particles[i].getComponent<TransformComponent>().position = startPositions[i];
+						particles[i].getComponent<ParticleComponent>().velocity = Vector3(0, 0, 0);
+					}
+
+					constraints.substeps = substeps;
+					constraints.iterations = iterations;
+					double time = 0;
+					float error = 0;
+					for (int frame = 0; frame < frames; frame++)
+					{
+						integration.Update(deltaTime);
+						time += TimeMilliseconds(1, [&]() { constraints.Update(deltaTime); });
+						error = std::max(error, constraints.GetSolver().GetMaxRelativeError());
+					}
+					std::cout << substeps << " | " << iterations << " | " << time / frames << " | " << error << std::endl;
+					assert(error <= maxRelativeError && "rods stretched more than the benchmark allows");
+				}
+			}
+		}
+
+		void BenchmarkDistanceConstraints()
+		{
+			// 2.5 m ropes at the system's default substeps and iterations: the rods have to hold within 3%
+			const DistanceConstraintSystem defaults;
+			BenchmarkChains(400, 25, { defaults.substeps }, { defaults.iterations }, 0.03f);
+
+			// 10 m ropes, and one 1000 m chain carrying 10000 particles, are past what the defaults converge on and are
+			// only measured: at the defaults the ropes stretch by about 10% and the long chain by about 20% while they
+			// swing, and the long chain by several times its link length with one substep
+			BenchmarkChains(100, 100, { defaults.substeps, 2 * defaults.substeps }, { 1, 4 }, INFINITY);
+			BenchmarkChains(1, 10000, { 1, defaults.substeps, 2 * defaults.substeps }, { 1, 4 }, INFINITY);
+		}
+
+		// What each integration method costs per step, and how far it ends from the exact answer
+		void BenchmarkIntegrationMethods()
+		{
+			const int count = 200000;
+			const int steps = 60;
+			const float deltaTime = 1 / 60.0f;
+
+			// Thrown particles under gravity alone, where the exact path is a parabola
+			ECSWorld world;
+			world.getSystemManager().addSystem<ParticleIntegrationSystem>();
+			std::vector<Vector3> startPositions;
+			std::vector<Vector3> startVelocities;
+			for (int i = 0; i < count; i++)
+			{
+				startPositions.push_back(Vector3(RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f), RandomFloat(-100.0f, 100.0f)));
+				startVelocities.push_back(Vector3(RandomFloat(-5.0f, 5.0f), RandomFloat(-5.0f, 5.0f), RandomFloat(-5.0f, 5.0f)));
+				auto e = world.createEntity();
+				e.addComponent<TransformComponent>(startPositions.back());
+				e.addComponent<ParticleComponent>(1.0f, startVelocities.back());
+			}
+			world.update();
+			auto& integration = world.getSystemManager().getSystem<ParticleIntegrationSystem>();
+			const auto entities = integration.getEntities();
+
+			std::cout << count << " particles, " << steps << " steps" << std::endl;
+			std::cout << "method | ms per step | largest distance from the parabola" << std::endl;
+			const std::pair<IntegrationMethod, const char*> methods[] = {
+				{ IntegrationMethod::SymplecticEuler, "symplectic Euler" },
+				{ IntegrationMethod::VelocityVerlet, "velocity Verlet" } };
+			for (const auto& method : methods)
+			{
+				for (size_t i = 0; i < entities.size(); i++)
+				{
+					entities[i].getComponent<TransformComponent>().position = startPositions[i];
+					entities[i].getComponent<ParticleComponent>().velocity = startVelocities[i];
+				}
+
+				integration.method = method.first;
+				auto time = TimeMilliseconds(steps, [&]() { integration.Update(deltaTime); });
+
+				const float duration = steps * deltaTime;
+				float error = 0;
+				for (size_t i = 0; i < entities.size(); i++)
+				{
+					const auto exact = startPositions[i] + startVelocities[i] * duration + 0.5f * integration.gravity * duration * duration;
+					error = std::max(error, glm::length(entities[i].getComponent<TransformComponent>().position - exact));
+				}
+				std::cout << method.second << " | " << time << " | " << error << std::endl;
+			}
+
+			// A force that changes with the position, where the order of the method shows
+			std::cout << "spring oscillator, distance from the exact answer after 10 periods" << std::endl;
+			std::cout << "step | symplectic Euler | velocity Verlet | RK4" << std::endl;
+			const float duration = 20 * glm::pi<float>();
+			for (float step : { 1 / 240.0f, 1 / 60.0f, 1 / 15.0f, 1 / 4.0f })
+			{
+				std::cout << step << " | " << OscillatorError<SymplecticEuler>(step, duration) << " | " <<
+					OscillatorError<VelocityVerlet>(step, duration) << " | " << OscillatorError<RungeKutta4>(step, duration) << std::endl;
+			}
+		}
+
+		// The systems of the scene in the order Main.cpp schedules them, each replaced by a task that spins for the
+		// same time so the schedule runs without a window. Prints which tasks may run next to which by the access the
+		// systems declare, and which did on this machine.
+		void BenchmarkScheduler()
+		{
+			const double taskMilliseconds = 1;
+
+			ECSWorld world;
+			auto& systems = world.getSystemManager();
+			systems.addSystem<BuoyancyForceGeneratorSystem>();
+			systems.addSystem<InputEventSystem>();
+			systems.addSystem<FPSControlSystem>();
+			systems.addSystem<RotateSystem>();
+			systems.addSystem<ParticleSpawnerSystem>();
+			systems.addSystem<SpringNetworkSystem>();
+			systems.addSystem<ParticleIntegrationSystem>();
+			systems.addSystem<DistanceConstraintSystem>();
+			systems.addSystem<SphereContactGeneratorSystem>();
+			systems.addSystem<ParticleContactResolutionSystem>();
+			systems.addSystem<ParticleSleepSystem>();
+			systems.addSystem<DynamicDirectionalLightSystem>();
+			systems.addSystem<DynamicPointLightSystem>();
+			systems.addSystem<DynamicSpotLightSystem>();
+			systems.addSystem<RenderingSystem>();
+
+			struct Task
+			{
+				const char* name;
+				ECSSystem* system;
+			};
+			const std::vector<Task> tasks = {
+				{ "buoyancy", &systems.getSystem<BuoyancyForceGeneratorSystem>() },
+				{ "input", &systems.getSystem<InputEventSystem>() },
+				{ "fps control", &systems.getSystem<FPSControlSystem>() },
+				{ "rotate", &systems.getSystem<RotateSystem>() },
+				{ "spawner", &systems.getSystem<ParticleSpawnerSystem>() },
+				{ "springs", &systems.getSystem<SpringNetworkSystem>() },
+				{ "integration", &systems.getSystem<ParticleIntegrationSystem>() },
+				{ "distance constraints", &systems.getSystem<DistanceConstraintSystem>() },
+				{ "sphere contacts", &systems.getSystem<SphereContactGeneratorSystem>() },
+				{ "wake touched", &systems.getSystem<ParticleSleepSystem>() },
+				{ "contact resolution", &systems.getSystem<ParticleContactResolutionSystem>() },
+				{ "sleep", &systems.getSystem<ParticleSleepSystem>() },
+				{ "directional light", &systems.getSystem<DynamicDirectionalLightSystem>() },
+				{ "point lights", &systems.getSystem<DynamicPointLightSystem>() },
+				{ "spot lights", &systems.getSystem<DynamicSpotLightSystem>() },
+				{ "rendering", &systems.getSystem<RenderingSystem>() } };
+			const auto count = tasks.size();
+
+			// Each task waits for the earlier tasks it conflicts with, and for what they wait for
+			std::vector<std::vector<bool>> waitsFor(count, std::vector<bool>(count, false));
+			for (size_t task = 0; task < count; task++)
+			{
+				for (size_t earlier = 0; earlier < task; earlier++)
+				{
+					if (tasks[earlier].system->conflictsWith(*tasks[task].system))
+					{
+						waitsFor[task][earlier] = true;
+						for (size_t before = 0; before < earlier; before++)
+						{
+							waitsFor[task][before] = waitsFor[task][before] || waitsFor[earlier][before];
+						}
+					}
+				}
+			}
+
+			std::vector<double> starts(count), ends(count);
+			std::vector<unsigned int> threads(count);
+			const auto begin = std::chrono::high_resolution_clock::now();
+			const auto since = [begin]()
+			{
+				return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+			};
+			for (size_t task = 0; task < count; task++)
+			{
+				systems.schedule(*tasks[task].system, [&, task]()
+				{
+					threads[task] = Mix::ThreadPool::getThreadIndex();
+					starts[task] = since();
+					while (since() - starts[task] < taskMilliseconds)
+					{
+					}
+					ends[task] = since();
+				});
+			}
+			systems.runScheduled();
+			const double time = since();
+
+			std::cout << count << " tasks of " << taskMilliseconds << " ms, " << systems.getThreadPool().getThreadCount() << " workers" << std::endl;
+			std::cout << "task | thread | may run next to | ran next to" << std::endl;
+			for (size_t task = 0; task < count; task++)
+			{
+				std::string independent;
+				std::string overlapped;
+				for (size_t other = 0; other < count; other++)
+				{
+					if (other == task || waitsFor[task][other] || waitsFor[other][task])
+					{
+						continue;
+					}
+					independent += std::string(independent.empty() ? "" : ", ") + tasks[other].name;
+					if (starts[task] < ends[other] && starts[other] < ends[task])
+					{
+						overlapped += std::string(overlapped.empty() ? "" : ", ") + tasks[other].name;
+					}
+				}
+				std::cout << tasks[task].name << " | " << (threads[task] == 0 ? "main" : "worker") << " | "
+					<< (independent.empty() ? "-" : independent) << " | " << (overlapped.empty() ? "-" : overlapped) << std::endl;
+			}
+			std::cout << "ms for the schedule | " << time << " (" << count * taskMilliseconds << " one after another)" << std::endl;
+		}
+	}
+
+	bool RunBenchmark(const std::string& name)
+	{
+		struct Benchmark
+		{
+			const char* name;
+			void(*run)();
+		};
+		const Benchmark benchmarks[] = {
+			{ "broadphase", BenchmarkSphereBroadphase },
+			{ "narrowphase", BenchmarkSphereNarrowphase },
+			{ "integration", BenchmarkParticleIntegration },
+			{ "springs", BenchmarkSpringNetwork },
+			{ "implicit", BenchmarkImplicitSprings },
+			{ "constraints", BenchmarkDistanceConstraints },
+			{ "methods", BenchmarkIntegrationMethods },
+			{ "scheduler", BenchmarkScheduler } };
+
+		bool found = false;
+		for (const auto& benchmark : benchmarks)
+		{
+			if (name == "all" || name == benchmark.name)
+			{
+				std::cout << "== " << benchmark.name << std::endl;
+				benchmark.run();
+				found = true;
+			}
+		}
+
+		if (!found)
+		{
+			std::cout << "no benchmark called " << name << ", there are:";
+			for (const auto& benchmark : benchmarks)
+			{
+				std::cout << " " << benchmark.name;
+			}
+			std::cout << " and all" << std::endl;
+		}
+		return found;
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <string>
+
+namespace Reality
+{
+	/*
+		Measurements of the physics without a window, printed to the console. Run one by passing its name on the
+		command line (e.g. "OpenGLEngine.exe springs"), "all" runs all of them. Unknown names print the list.
+
+		Returns false if there is no benchmark of that name.
+	*/
+	bool RunBenchmark(const std::string& name);
+}
@@ -7,6 +7,8 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<BungeeComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireMainThread();
 	}
 
 
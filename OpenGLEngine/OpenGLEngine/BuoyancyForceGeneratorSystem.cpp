@@ -8,6 +8,9 @@ namespace Reality
 	{
 		requireComponent<BuoyancyComponent>();
 		requireComponent<TransformComponent>();
+		requireWriteAccess<BuoyancyComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireExclusiveAccess();
 	}
 
 	void BuoyancyForceGeneratorSystem::Update(float deltaTime)
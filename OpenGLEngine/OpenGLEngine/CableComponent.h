@@ -4,11 +4,13 @@ namespace Reality
 {
 	struct CableComponent
 	{
-		CableComponent(ECSEntity a = ECSEntity(), ECSEntity b = ECSEntity(), float _maxLength = 10, float _restitution = 1.0f)
-			: entityA(a), entityB(b), maxLength(_maxLength), restitution(_restitution){}
+		CableComponent(ECSEntity a = ECSEntity(), ECSEntity b = ECSEntity(), float _maxLength = 10, float _restitution = 1.0f, float _compliance = 0)
+			: entityA(a), entityB(b), maxLength(_maxLength), restitution(_restitution), compliance(_compliance){}
 		ECSEntity entityA;
 		ECSEntity entityB;
 		float maxLength;
 		float restitution;
+		// 0 for a cable that doesn't stretch, otherwise the inverse of its stiffness (DistanceConstraintSystem only)
+		float compliance;
 	};
 }
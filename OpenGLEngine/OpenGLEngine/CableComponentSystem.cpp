@@ -1,16 +1,19 @@
 #include "CableComponentSystem.h"
 #include "TransformComponent.h"
-#include "ParticleContactComponent.h"
+#include "ParticleContact.h"
 
 namespace Reality
 {
 	CableComponentSystem::CableComponentSystem()
 	{
 		requireComponent<CableComponent>();
+		requireReadAccess<TransformComponent>();
+		requireMainThread();
 	}
 
 	void CableComponentSystem::Update(float deltaTime)
 	{
+		auto& events = getWorld().getEventManager();
 		for (auto e : getEntities())
 		{
 			auto& cable = e.getComponent<CableComponent>();
@@ -33,13 +36,13 @@ namespace Reality
 
 			float penetration = length - cable.maxLength;
 
-			auto contactEntity = getWorld().createEntity();
-			contactEntity.addComponent<ParticleContactComponent>(
+			events.emitEvent<ParticleContact>(
 				cable.entityA,
 				cable.entityB,
 				cable.restitution,
 				normal,
-				penetration);
+				penetration,
+				CableContactFeature);
 		}
 	}
 }
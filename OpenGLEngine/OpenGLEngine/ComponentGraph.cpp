@@ -0,0 +1,132 @@
+#include "ComponentGraph.h"
+#include "TransformComponent.h"
+#include "ParticleComponent.h"
+
+namespace Reality
+{
+	namespace
+	{
+		const uint32_t NoNode = ~0u;
+	}
+
+	const uint32_t ComponentGraph::NoEdge;
+
+	ComponentGraph::ComponentGraph() : changed(false)
+	{
+	}
+
+	void ComponentGraph::Clear(uint32_t kindCount)
+	{
+		owners.clear();
+		ownerEnds.clear();
+		ends.clear();
+		edgeOf.resize(kindCount);
+		for (auto& edges : edgeOf)
+		{
+			edges.clear();
+		}
+		for (auto node : nodes)
+		{
+			nodeOf[node.getIndex()] = NoNode;
+		}
+		nodes.clear();
+		nodeHasTransform.clear();
+		transforms.clear();
+		particles.clear();
+		stamps.clear();
+		changed = false;
+	}
+
+	uint32_t ComponentGraph::AddEdge(uint32_t kind, ECSEntity owner, ECSEntity a, ECSEntity b)
+	{
+		const auto edge = (uint32_t)owners.size();
+		owners.push_back(owner);
+		ownerEnds.push_back(a);
+		ownerEnds.push_back(b);
+		stamps.push_back(syncStamp);
+
+		auto& edges = edgeOf[kind];
+		if (owner.getIndex() >= edges.size())
+		{
+			edges.resize(owner.getIndex() + 1, NoEdge);
+		}
+		edges[owner.getIndex()] = edge;
+
+		for (auto e : { a, b })
+		{
+			const auto index = e.getIndex();
+			if (index >= nodeOf.size())
+			{
+				nodeOf.resize(index + 1, NoNode);
+			}
+			if (nodeOf[index] == NoNode)
+			{
+				nodeOf[index] = (uint32_t)nodes.size();
+				nodes.push_back(e);
+				nodeHasTransform.push_back(e.hasComponent<TransformComponent>() ? 1 : 0);
+				transforms.push_back(nullptr);
+				particles.push_back(nullptr);
+			}
+			ends.push_back(nodeOf[index]);
+		}
+		return edge;
+	}
+
+	void ComponentGraph::BeginSync()
+	{
+		syncStamp++;
+	}
+
+	uint32_t ComponentGraph::FindEdge(uint32_t kind, ECSEntity owner, ECSEntity a, ECSEntity b)
+	{
+		const auto index = owner.getIndex();
+		const auto edge = kind < edgeOf.size() && index < edgeOf[kind].size() ? edgeOf[kind][index] : NoEdge;
+		if (edge == NoEdge || !owners[edge].isSame(owner) || !ownerEnds[2 * edge].isSame(a) || !ownerEnds[2 * edge + 1].isSame(b))
+		{
+			changed = true;
+			return NoEdge;
+		}
+		stamps[edge] = syncStamp;
+		return edge;
+	}
+
+	bool ComponentGraph::EndSync(Mix::ThreadPool& threadPool)
+	{
+		if (changed)
+		{
+			return false;
+		}
+
+		// Edges whose component went away
+		threadPool.parallelFor((unsigned int)stamps.size(), Mix::DEFAULT_GRAIN_SIZE, [this](unsigned int begin, unsigned int end)
+		{
+			for (auto edge = begin; edge < end; edge++)
+			{
+				if (stamps[edge] != syncStamp)
+				{
+					changed = true;
+					return;
+				}
+			}
+		});
+		return !changed;
+	}
+
+	bool ComponentGraph::CheckTransform(uint32_t node)
+	{
+		const auto e = nodes[node];
+		particles[node] = e.hasComponent<ParticleComponent>() ? &e.getComponent<ParticleComponent>() : nullptr;
+		transforms[node] = nullptr;
+		const bool hasTransform = e.hasComponent<TransformComponent>();
+		if (hasTransform != (nodeHasTransform[node] != 0))
+		{
+			changed = true;
+			return false;
+		}
+		if (hasTransform)
+		{
+			transforms[node] = &e.getComponent<TransformComponent>();
+		}
+		return hasTransform;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "ECSConfig.h"
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+
+namespace Reality
+{
+	struct TransformComponent;
+	struct ParticleComponent;
+
+	/*
+		The entities that components link in pairs, springs, rods and cables, as a graph: every component is an edge
+		and the entities at its ends are the nodes. Systems that compile such components into a flat table keep one to
+		number the table's rows and nodes, and to find out when the table has to be rebuilt.
+
+		Rebuilding adds the edges kind by kind with AddEdge. Edges are numbered in the order they are added, nodes in
+		the order the edges first reach them, so neighbouring edges read neighbouring nodes.
+
+		When NeedsSync says the components may have changed, the system walks them between BeginSync and EndSync and
+		looks each one up with FindEdge. The lookup goes through the component's entity, so the components can be
+		walked in any order and at the same time. EndSync says whether the graph is still the one the components
+		describe. The nodes' components are looked up again with CheckTransform in the same step, and kept for the
+		steps in which nothing changed.
+	*/
+	class ComponentGraph
+	{
+	public:
+		static const uint32_t NoEdge = ~0u;
+
+		ComponentGraph();
+
+		void Clear(uint32_t kindCount);
+		// Adds the component of kind that owner has, linking a and b. Returns the edge.
+		uint32_t AddEdge(uint32_t kind, ECSEntity owner, ECSEntity a, ECSEntity b);
+
+		uint32_t GetEdgeCount() const { return (uint32_t)owners.size(); }
+		uint32_t GetNodeCount() const { return (uint32_t)nodes.size(); }
+		uint32_t GetA(uint32_t edge) const { return ends[2 * edge]; }
+		uint32_t GetB(uint32_t edge) const { return ends[2 * edge + 1]; }
+		ECSEntity GetEntity(uint32_t node) const { return nodes[node]; }
+		// Whether the node's entity had a transform when it was added
+		bool HadTransform(uint32_t node) const { return nodeHasTransform[node] != 0; }
+
+		// Whether something the graph was synced from may have changed since the last call: a node gained or lost its
+		// transform, an entity gained or lost a component or died, or a component of one of the types Ts was written
+		template<typename... Ts>
+		bool NeedsSync(const Mix::EntityManager& entities)
+		{
+			const uint32_t current[] = { entities.getStructureVersion(), entities.getComponentVersion<Ts>()... };
+			const bool same = !changed && versions.size() == sizeof(current) / sizeof(current[0]) && std::equal(versions.begin(), versions.end(), current);
+			versions.assign(std::begin(current), std::end(current));
+			return !same;
+		}
+
+		void BeginSync();
+		// The edge of owner's component of kind, if it still links a and b. NoEdge for a component that isn't in the
+		// graph, then EndSync returns false. Can be called from any thread.
+		uint32_t FindEdge(uint32_t kind, ECSEntity owner, ECSEntity a, ECSEntity b);
+		// False if the graph has to be rebuilt: a component wasn't found, one wasn't walked since BeginSync, or a node
+		// gained or lost its transform
+		bool EndSync(Mix::ThreadPool& threadPool);
+
+		// Whether the node's entity has a transform, and had one when it was added. One that it gained or lost since
+		// counts as missing until the rebuild EndSync then asks for. Also looks up the node's components for
+		// GetTransform and GetParticle. Can be called from any thread.
+		bool CheckTransform(uint32_t node);
+		// The node's components as CheckTransform last found them, nullptr if it has none (or its transform counts as
+		// missing). They stay valid while the world's structure version doesn't change.
+		TransformComponent* GetTransform(uint32_t node) const { return transforms[node]; }
+		ParticleComponent* GetParticle(uint32_t node) const { return particles[node]; }
+
+	private:
+		// Entity of the component of each edge, and the ends of each edge as nodes
+		std::vector<ECSEntity> owners;
+		std::vector<ECSEntity> ownerEnds;
+		std::vector<uint32_t> ends;
+		// Edge of each kind's components, index = kind, then entity index
+		std::vector<std::vector<uint32_t>> edgeOf;
+
+		std::vector<ECSEntity> nodes;
+		std::vector<uint8_t> nodeHasTransform;
+		std::vector<TransformComponent*> transforms;
+		std::vector<ParticleComponent*> particles;
+		// Node of each entity, index = entity index
+		std::vector<uint32_t> nodeOf;
+
+		// Sync that last found each edge
+		std::vector<uint32_t> stamps;
+		uint32_t syncStamp = 0;
+		std::atomic<bool> changed;
+		// Structure and component versions at the last NeedsSync
+		std::vector<uint32_t> versions;
+	};
+}
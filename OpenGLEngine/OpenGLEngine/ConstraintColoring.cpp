@@ -0,0 +1,73 @@
+#include "ConstraintColoring.h"
+#include <cassert>
+
+namespace Reality
+{
+	const uint32_t ConstraintColoring::MaxColors;
+
+	void ConstraintColoring::Reset(uint32_t bodyCount)
+	{
+		bodyColors.assign(bodyCount, 0);
+		constraintColors.clear();
+	}
+
+	void ConstraintColoring::AddConstraint(uint32_t a, uint32_t b)
+	{
+		assert(a != 0 || b != 0);
+		const uint64_t taken = (a != 0 ? bodyColors[a] : 0) | (b != 0 ? bodyColors[b] : 0);
+		uint32_t color = 0;
+		while (color < MaxColors && (taken >> color & 1) != 0)
+		{
+			color++;
+		}
+		constraintColors.push_back((uint8_t)color);
+		if (color == MaxColors)
+		{
+			return;
+		}
+
+		const uint64_t bit = (uint64_t)1 << color;
+		if (a != 0)
+		{
+			bodyColors[a] |= bit;
+		}
+		if (b != 0)
+		{
+			bodyColors[b] |= bit;
+		}
+	}
+
+	void ConstraintColoring::Build()
+	{
+		for (auto& count : counts)
+		{
+			count = 0;
+		}
+		for (const auto color : constraintColors)
+		{
+			counts[color]++;
+		}
+
+		// One batch per color that was taken, the overflow last
+		batches.clear();
+		uint32_t first = 0;
+		for (uint32_t color = 0; color <= MaxColors; color++)
+		{
+			const auto count = counts[color];
+			if (count > 0)
+			{
+				batches.push_back(Batch{ first, count });
+			}
+			counts[color] = first;
+			first += count;
+		}
+		hasOverflow = counts[MaxColors] < first;
+
+		// Counting sort of the constraints into their batches, in the order they were added
+		batchConstraints.resize(constraintColors.size());
+		for (uint32_t constraint = 0; constraint < constraintColors.size(); constraint++)
+		{
+			batchConstraints[counts[constraintColors[constraint]]++] = constraint;
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Splits the constraints of an island into batches in which no two constraints share a body, by greedy graph
+		coloring: each constraint takes the lowest color neither of its bodies has yet. The constraints of a batch can
+		then be solved at the same time, the batches one after the other.
+
+		Body 0 is the static world, it never moves so any number of constraints of a batch can touch it. A body has at
+		most MaxColors colors, constraints that find all of them taken go into one last batch that has to be solved one
+		constraint at a time.
+	*/
+	class ConstraintColoring
+	{
+	public:
+		struct Batch
+		{
+			// the batch's constraints are GetConstraints()[first, first + count)
+			uint32_t first;
+			uint32_t count;
+		};
+
+		static const uint32_t MaxColors = 64;
+
+		void Reset(uint32_t bodyCount);
+		// Colors a constraint between two bodies. Constraints are numbered in the order they are added.
+		void AddConstraint(uint32_t a, uint32_t b);
+		// Groups the constraints by color, constraints keep their order within a batch
+		void Build();
+
+		const std::vector<Batch>& GetBatches() const { return batches; }
+		const std::vector<uint32_t>& GetConstraints() const { return batchConstraints; }
+		// Whether the last batch is the one whose constraints may share bodies
+		bool HasOverflow() const { return hasOverflow; }
+
+	private:
+		// colors taken by the constraints of each body, index = body
+		std::vector<uint64_t> bodyColors;
+		// MaxColors for the constraints that didn't get one
+		std::vector<uint8_t> constraintColors;
+		// constraints per color, then where each color's batch starts
+		uint32_t counts[MaxColors + 1];
+
+		std::vector<Batch> batches;
+		std::vector<uint32_t> batchConstraints;
+		bool hasOverflow = false;
+	};
+}
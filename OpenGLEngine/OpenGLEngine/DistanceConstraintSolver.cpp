@@ -0,0 +1,203 @@
+#include "DistanceConstraintSolver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Reality
+{
+	void DistanceConstraintSolver::Reset(uint32_t nodeCount)
+	{
+		positions.assign(nodeCount, Vector3(0, 0, 0));
+		previousPositions.assign(nodeCount, Vector3(0, 0, 0));
+		velocities.assign(nodeCount, Vector3(0, 0, 0));
+		inverseMasses.assign(nodeCount, 0.0f);
+		a.clear();
+		b.clear();
+		lengths.clear();
+		compliances.clear();
+		restitutions.clear();
+		isCable.clear();
+	}
+
+	void DistanceConstraintSolver::AddConstraint(uint32_t nodeA, uint32_t nodeB, float length, float compliance, bool cable, float restitution)
+	{
+		a.push_back(nodeA);
+		b.push_back(nodeB);
+		lengths.push_back(length);
+		compliances.push_back(compliance);
+		restitutions.push_back(restitution);
+		isCable.push_back(cable ? 1 : 0);
+	}
+
+	void DistanceConstraintSolver::Build()
+	{
+		taut.assign(GetConstraintCount(), 0);
+		lambdas.assign(GetConstraintCount(), 0.0f);
+		separatingSpeeds.assign(GetConstraintCount(), 0.0f);
+
+		// Body 0 is the coloring's static world, so the nodes start at 1
+		coloring.Reset(GetNodeCount() + 1);
+		for (uint32_t constraint = 0; constraint < GetConstraintCount(); constraint++)
+		{
+			coloring.AddConstraint(a[constraint] + 1, b[constraint] + 1);
+		}
+		coloring.Build();
+	}
+
+	void DistanceConstraintSolver::Solve(float deltaTime, int substeps, int iterations, Mix::ThreadPool& threadPool)
+	{
+		if (deltaTime <= 0 || substeps < 1 || iterations < 1)
+		{
+			return;
+		}
+		const float substep = deltaTime / substeps;
+		const float inverseSubstepSquared = 1 / (substep * substep);
+		const auto grainSize = Mix::ThreadPool::alignToCacheLines(Mix::DEFAULT_GRAIN_SIZE);
+		const auto nodeCount = GetNodeCount();
+
+		for (uint32_t constraint = 0; constraint < GetConstraintCount(); constraint++)
+		{
+			taut[constraint] = 0;
+			if (isCable[constraint])
+			{
+				const auto delta = positions[b[constraint]] - positions[a[constraint]];
+				const float length = glm::length(delta);
+				separatingSpeeds[constraint] = length > 0 ? glm::dot(velocities[b[constraint]] - velocities[a[constraint]], delta / length) : 0.0f;
+			}
+		}
+
+		const auto& batches = coloring.GetBatches();
+		const auto& batchConstraints = coloring.GetConstraints();
+		for (int step = 0; step < substeps; step++)
+		{
+			threadPool.parallelFor(nodeCount, grainSize, [&](unsigned int begin, unsigned int end)
+			{
+				for (auto node = begin; node < end; node++)
+				{
+					previousPositions[node] = positions[node];
+					positions[node] += substep * velocities[node];
+				}
+			});
+			std::fill(lambdas.begin(), lambdas.end(), 0.0f);
+
+			for (int iteration = 0; iteration < iterations; iteration++)
+			{
+				for (size_t batch = 0; batch < batches.size(); batch++)
+				{
+					const auto first = batches[batch].first;
+					const auto project = [&](unsigned int begin, unsigned int end)
+					{
+						for (auto i = begin; i < end; i++)
+						{
+							Project(batchConstraints[first + i], inverseSubstepSquared);
+						}
+					};
+
+					// The overflow's constraints share nodes, they go one at a time
+					if (coloring.HasOverflow() && batch + 1 == batches.size())
+					{
+						project(0, batches[batch].count);
+					}
+					else
+					{
+						threadPool.parallelFor(batches[batch].count, grainSize, project);
+					}
+				}
+			}
+
+			threadPool.parallelFor(nodeCount, grainSize, [&](unsigned int begin, unsigned int end)
+			{
+				for (auto node = begin; node < end; node++)
+				{
+					velocities[node] = (positions[node] - previousPositions[node]) / substep;
+				}
+			});
+		}
+
+		// Cables that went taut lose their ends' separating speed, and get the restitution's share of it back
+		for (uint32_t constraint = 0; constraint < GetConstraintCount(); constraint++)
+		{
+			const float totalInverseMass = inverseMasses[a[constraint]] + inverseMasses[b[constraint]];
+			if (!taut[constraint] || separatingSpeeds[constraint] <= 0 || totalInverseMass <= 0)
+			{
+				continue;
+			}
+
+			const auto delta = positions[b[constraint]] - positions[a[constraint]];
+			const float length = glm::length(delta);
+			if (length <= 0)
+			{
+				continue;
+			}
+			const auto normal = delta / length;
+			const float speed = glm::dot(velocities[b[constraint]] - velocities[a[constraint]], normal);
+			const float change = -restitutions[constraint] * separatingSpeeds[constraint] - speed;
+			if (change >= 0)
+			{
+				continue;
+			}
+			velocities[a[constraint]] -= normal * (change * inverseMasses[a[constraint]] / totalInverseMass);
+			velocities[b[constraint]] += normal * (change * inverseMasses[b[constraint]] / totalInverseMass);
+		}
+	}
+
+	float DistanceConstraintSolver::GetMaxError() const
+	{
+		float maxError = 0;
+		for (uint32_t constraint = 0; constraint < GetConstraintCount(); constraint++)
+		{
+			const float error = glm::length(positions[a[constraint]] - positions[b[constraint]]) - lengths[constraint];
+			maxError = std::max(maxError, isCable[constraint] ? error : std::abs(error));
+		}
+		return maxError;
+	}
+
+	float DistanceConstraintSolver::GetMaxRelativeError() const
+	{
+		float maxError = 0;
+		for (uint32_t constraint = 0; constraint < GetConstraintCount(); constraint++)
+		{
+			if (lengths[constraint] <= 0)
+			{
+				continue;
+			}
+			const float error = (glm::length(positions[a[constraint]] - positions[b[constraint]]) - lengths[constraint]) / lengths[constraint];
+			maxError = std::max(maxError, isCable[constraint] ? error : std::abs(error));
+		}
+		return maxError;
+	}
+
+	void DistanceConstraintSolver::Project(uint32_t constraint, float inverseSubstepSquared)
+	{
+		const auto nodeA = a[constraint];
+		const auto nodeB = b[constraint];
+		const auto delta = positions[nodeA] - positions[nodeB];
+		const float length = glm::length(delta);
+		const float error = length - lengths[constraint];
+		// A slack cable only lets go of what it pulled earlier in the substep
+		if (length <= 0 || (isCable[constraint] && error <= 0 && lambdas[constraint] >= 0))
+		{
+			return;
+		}
+
+		// The compliance is scaled by the substep, so the stiffness doesn't depend on it
+		const float totalInverseMass = inverseMasses[nodeA] + inverseMasses[nodeB];
+		const float scaledCompliance = compliances[constraint] * inverseSubstepSquared;
+		if (totalInverseMass + scaledCompliance <= 0)
+		{
+			return;
+		}
+
+		float lambdaChange = (-error - scaledCompliance * lambdas[constraint]) / (totalInverseMass + scaledCompliance);
+		if (isCable[constraint])
+		{
+			// Pulling is a negative multiplier
+			lambdaChange = std::min(lambdas[constraint] + lambdaChange, 0.0f) - lambdas[constraint];
+			taut[constraint] = 1;
+		}
+		lambdas[constraint] += lambdaChange;
+
+		const auto correction = (lambdaChange / length) * delta;
+		positions[nodeA] += inverseMasses[nodeA] * correction;
+		positions[nodeB] -= inverseMasses[nodeB] * correction;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "ECSConfig.h"
+#include "ConstraintColoring.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Extended position based dynamics (XPBD) for constraints on the distance between two nodes: rods keep it at
+		their length, cables only keep it from growing past theirs.
+
+		A step is split into substeps. Each one moves the nodes by their velocity, projects every constraint straight
+		onto the positions a number of times and takes the velocities from how far the nodes moved. Each constraint
+		keeps the multiplier it has applied over the passes of a substep, so its compliance comes out the same however
+		many passes are made: with compliance 0 a constraint is rigid, otherwise it gives like a spring of stiffness
+		1 / compliance. Cables only ever pull.
+
+		Rigid constraints are only met as far as the passes converge. A pass is one Gauss-Seidel sweep, and a
+		correction travels one link per sweep, so long heavy chains stretch; more substeps help more than more passes
+		of one substep, and both cost the same.
+
+		The constraints are colored when they are built, so those of one color share no node and are projected at the
+		same time on the thread pool. Cables bounce back with their restitution when they go taut.
+	*/
+	class DistanceConstraintSolver
+	{
+	public:
+		void Reset(uint32_t nodeCount);
+		// Constraints are numbered in the order they are added
+		void AddConstraint(uint32_t a, uint32_t b, float length, float compliance, bool isCable, float restitution);
+		// Colors the constraints, call it after the last one is added
+		void Build();
+
+		uint32_t GetNodeCount() const { return (uint32_t)positions.size(); }
+		uint32_t GetConstraintCount() const { return (uint32_t)a.size(); }
+
+		// Changing the constants keeps the colors
+		void SetConstants(uint32_t constraint, float length, float compliance, float restitution)
+		{
+			lengths[constraint] = length;
+			compliances[constraint] = compliance;
+			restitutions[constraint] = restitution;
+		}
+		// State at the start of the step. Nodes with no inverse mass aren't moved by the constraints.
+		void SetNode(uint32_t node, const Vector3& position, const Vector3& velocity, float inverseMass)
+		{
+			positions[node] = position;
+			velocities[node] = velocity;
+			inverseMasses[node] = inverseMass;
+		}
+		const Vector3& GetPosition(uint32_t node) const { return positions[node]; }
+		const Vector3& GetVelocity(uint32_t node) const { return velocities[node]; }
+		uint32_t GetA(uint32_t constraint) const { return a[constraint]; }
+		uint32_t GetB(uint32_t constraint) const { return b[constraint]; }
+		bool IsCable(uint32_t constraint) const { return isCable[constraint] != 0; }
+
+		// Moves the nodes over deltaTime
+		void Solve(float deltaTime, int substeps, int iterations, Mix::ThreadPool& threadPool);
+		// How far the rods are from their length, or the cables past theirs, at most
+		float GetMaxError() const;
+		// The same relative to the constraint's length
+		float GetMaxRelativeError() const;
+
+	private:
+		void Project(uint32_t constraint, float inverseSubstepSquared);
+
+		std::vector<Vector3> positions;
+		std::vector<Vector3> previousPositions;
+		std::vector<Vector3> velocities;
+		std::vector<float> inverseMasses;
+
+		std::vector<uint32_t> a, b;
+		std::vector<float> lengths;
+		std::vector<float> compliances;
+		std::vector<float> restitutions;
+		std::vector<uint8_t> isCable;
+		// Multiplier applied by each constraint in the current substep
+		std::vector<float> lambdas;
+		// Whether the cable went taut in the last step, and how fast its ends were moving apart before it
+		std::vector<uint8_t> taut;
+		std::vector<float> separatingSpeeds;
+
+		ConstraintColoring coloring;
+	};
+}
@@ -0,0 +1,193 @@
+#include "DistanceConstraintSystem.h"
+#include "TransformComponent.h"
+#include "ParticleComponent.h"
+#include "RodComponent.h"
+#include "CableComponent.h"
+#include "ParticleIntegrationSystem.h"
+
+namespace Reality
+{
+	namespace
+	{
+		// Kinds of components in the graph
+		enum ConstraintKind : uint32_t
+		{
+			RodKind,
+			CableKind,
+			ConstraintKindCount
+		};
+	}
+
+	DistanceConstraintSystem::DistanceConstraintSystem()
+	{
+		requireReadAccess<RodComponent>();
+		requireReadAccess<CableComponent>();
+		requireWriteAccess<TransformComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireMainThread();
+	}
+
+	void DistanceConstraintSystem::Update(float deltaTime)
+	{
+		// The components are only walked when something could have changed them
+		const bool sync = graph.NeedsSync<RodComponent, CableComponent>(getWorld().getEntityManager());
+		if (sync && !SyncConstants())
+		{
+			Rebuild();
+		}
+
+		// The step is taken back the way ParticleIntegrationSystem's method took it
+		auto& systems = getWorld().getSystemManager();
+		const auto method = systems.hasSystem<ParticleIntegrationSystem>() ?
+			systems.getSystem<ParticleIntegrationSystem>().method : IntegrationMethod::SymplecticEuler;
+		switch (method)
+		{
+		case IntegrationMethod::VelocityVerlet:
+			Solve<VelocityVerlet>(deltaTime, sync);
+			break;
+		default:
+			Solve<SymplecticEuler>(deltaTime, sync);
+			break;
+		}
+
+		if (drawConstraints)
+		{
+			Draw();
+		}
+	}
+
+	template<typename Method>
+	void DistanceConstraintSystem::Solve(float deltaTime, bool sync)
+	{
+		const auto grainSize = Mix::ThreadPool::alignToCacheLines(Mix::DEFAULT_GRAIN_SIZE);
+		getThreadPool().parallelFor(solver.GetNodeCount(), grainSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (auto node = begin; node < end; node++)
+			{
+				// Ends that gained or lost their transform stay where they were for this step
+				if (sync)
+				{
+					graph.CheckTransform(node);
+				}
+				const auto* transform = graph.GetTransform(node);
+				if (!transform)
+				{
+					continue;
+				}
+
+				// Back to where the particle was before this step's integration. The solver moves it with the step's
+				// mean velocity, so a node no constraint pulls ends where the integration put it.
+				const auto& position = transform->position;
+				if (const auto* particle = graph.GetParticle(node))
+				{
+					const auto velocity = Method::MeanVelocity(particle->velocity, particle->accelaration, deltaTime);
+					solver.SetNode(node, position - deltaTime * velocity, velocity, particle->inverseMass);
+				}
+				else
+				{
+					solver.SetNode(node, position, Vector3(0, 0, 0), 0);
+				}
+			}
+		});
+
+		solver.Solve(deltaTime, substeps, iterations, getThreadPool());
+
+		if (deltaTime > 0)
+		{
+			getThreadPool().parallelFor(solver.GetNodeCount(), grainSize, [&](unsigned int begin, unsigned int end)
+			{
+				for (auto node = begin; node < end; node++)
+				{
+					auto* transform = graph.GetTransform(node);
+					auto* particle = graph.GetParticle(node);
+					if (transform && particle)
+					{
+						// The constraints' change on top of the velocity the step ended with
+						const auto velocity = Method::MeanVelocity(particle->velocity, particle->accelaration, deltaTime);
+						transform->position = solver.GetPosition(node);
+						particle->velocity = solver.GetVelocity(node) + (particle->velocity - velocity);
+					}
+				}
+			});
+		}
+	}
+
+	bool DistanceConstraintSystem::SyncConstants()
+	{
+		graph.BeginSync();
+		auto sync = [&](uint32_t kind, ECSEntity e, ECSEntity a, ECSEntity b, float length, float compliance, float restitution)
+		{
+			const auto edge = graph.FindEdge(kind, e, a, b);
+			if (edge != ComponentGraph::NoEdge && edgeConstraints[edge] >= 0)
+			{
+				solver.SetConstants(edgeConstraints[edge], length, compliance, restitution);
+			}
+		};
+
+		const auto grainSize = Mix::DEFAULT_GRAIN_SIZE;
+		view<RodComponent>().parallelEach(grainSize, [&](ECSEntity e, RodComponent& rod)
+		{
+			sync(RodKind, e, rod.entityA, rod.entityB, rod.length, rod.compliance, 0);
+		});
+		view<CableComponent>().parallelEach(grainSize, [&](ECSEntity e, CableComponent& cable)
+		{
+			sync(CableKind, e, cable.entityA, cable.entityB, cable.maxLength, cable.compliance, cable.restitution);
+		});
+		return graph.EndSync(getThreadPool());
+	}
+
+	void DistanceConstraintSystem::Rebuild()
+	{
+		rebuildCount++;
+
+		struct NewConstraint
+		{
+			float length;
+			float compliance;
+			bool isCable;
+			float restitution;
+		};
+		std::vector<NewConstraint> constraints;
+		graph.Clear(ConstraintKindCount);
+		view<RodComponent>().each([&](ECSEntity e, RodComponent& rod)
+		{
+			graph.AddEdge(RodKind, e, rod.entityA, rod.entityB);
+			constraints.push_back(NewConstraint{ rod.length, rod.compliance, false, 0 });
+		});
+		view<CableComponent>().each([&](ECSEntity e, CableComponent& cable)
+		{
+			graph.AddEdge(CableKind, e, cable.entityA, cable.entityB);
+			constraints.push_back(NewConstraint{ cable.maxLength, cable.compliance, true, cable.restitution });
+		});
+
+		solver.Reset(graph.GetNodeCount());
+		edgeConstraints.clear();
+		for (uint32_t i = 0; i < constraints.size(); i++)
+		{
+			const auto a = graph.GetA(i);
+			const auto b = graph.GetB(i);
+			// Constraints need both ends' positions, until then they do nothing
+			int32_t constraint = -1;
+			if (graph.HadTransform(a) && graph.HadTransform(b))
+			{
+				constraint = (int32_t)solver.GetConstraintCount();
+				solver.AddConstraint(a, b, constraints[i].length, constraints[i].compliance, constraints[i].isCable, constraints[i].restitution);
+			}
+			edgeConstraints.push_back(constraint);
+		}
+		solver.Build();
+	}
+
+	void DistanceConstraintSystem::Draw()
+	{
+		for (uint32_t constraint = 0; constraint < solver.GetConstraintCount(); constraint++)
+		{
+			const auto& a = solver.GetPosition(solver.GetA(constraint));
+			const auto& b = solver.GetPosition(solver.GetB(constraint));
+			const bool isCable = solver.IsCable(constraint);
+			getWorld().data.renderUtil->DrawSphere(a, 1, isCable ? Color::Magenta : Color::Purple);
+			getWorld().data.renderUtil->DrawSphere(b, 1, isCable ? Color::Magenta : Color::Purple);
+			getWorld().data.renderUtil->DrawLine(a, b, isCable ? Color::Blue : Color::Yellow);
+		}
+	}
+}
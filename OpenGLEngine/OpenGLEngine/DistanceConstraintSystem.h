@@ -0,0 +1,55 @@
+#pragma once
+#include "ECSConfig.h"
+#include "DistanceConstraintSolver.h"
+#include "ComponentGraph.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Keeps rods at their length and cables from stretching past theirs by moving their ends directly, with the
+		XPBD substeps of DistanceConstraintSolver, instead of sending a contact for every violated one through the
+		contact resolver the way RodSystem and CableComponentSystem do.
+
+		The rod and cable components are only walked, on all the threads, to pick up changed constants in steps where
+		the world's versions say they may have changed, like SpringNetworkSystem does. The solver's constraints and
+		their colors are rebuilt when one is added or removed, changes ends, or an end gains or loses its transform.
+		Ends that aren't particles (sleeping ones included) don't move.
+
+		Runs right after ParticleIntegrationSystem: that step is taken back, with the method it was taken with, and
+		done again in substeps with the constraints.
+	*/
+	class DistanceConstraintSystem : public ECSSystem
+	{
+	public:
+		DistanceConstraintSystem();
+		void Update(float deltaTime);
+
+		int substeps = 16;
+		// Passes over the constraints per substep
+		int iterations = 1;
+		bool drawConstraints = true;
+
+		DistanceConstraintSolver& GetSolver() { return solver; }
+		int GetRebuildCount() const { return rebuildCount; }
+
+	private:
+		// Copies the constants of the components into the solver, false if a rod or cable was added, removed or
+		// changed ends, or an end gained or lost its transform, since the last rebuild
+		bool SyncConstants();
+		void Rebuild();
+		// Looks up the ends' components again if the constants were synced this step
+		template<typename Method>
+		void Solve(float deltaTime, bool sync);
+		void Draw();
+
+		DistanceConstraintSolver solver;
+		int rebuildCount = 0;
+
+		// Rods, then cables, are the edges, in the order the views walk them
+		ComponentGraph graph;
+		// Constraint of each edge in the solver, -1 if an end had no transform at the last rebuild
+		std::vector<int32_t> edgeConstraints;
+	};
+}
@@ -0,0 +1,255 @@
+#include "DynamicAabbTree.h"
+
+namespace Reality
+{
+	const int32_t DynamicAabbTree::NullNode;
+	const int DynamicAabbTree::MaxStackSize;
+
+	int32_t DynamicAabbTree::CreateProxy(const Aabb& box, uint32_t id)
+	{
+		const auto proxy = AllocateNode();
+		auto& node = nodes[proxy];
+		node.box = Aabb(box.min - Vector3(margin), box.max + Vector3(margin));
+		node.id = id;
+		node.height = 0;
+		InsertLeaf(proxy);
+		proxyCount++;
+		return proxy;
+	}
+
+	void DynamicAabbTree::DestroyProxy(int32_t proxy)
+	{
+		assert(nodes[proxy].IsLeaf());
+		RemoveLeaf(proxy);
+		FreeNode(proxy);
+		proxyCount--;
+	}
+
+	bool DynamicAabbTree::MoveProxy(int32_t proxy, const Aabb& box, const Vector3& displacement)
+	{
+		assert(nodes[proxy].IsLeaf());
+		if (nodes[proxy].box.Contains(box))
+		{
+			return false;
+		}
+
+		// Fatten the box, and stretch it the way the body moves so it stays inside for a few more steps
+		Aabb fat(box.min - Vector3(margin), box.max + Vector3(margin));
+		const auto stretch = 2.0f * displacement;
+		fat.min += glm::min(stretch, Vector3(0));
+		fat.max += glm::max(stretch, Vector3(0));
+
+		RemoveLeaf(proxy);
+		nodes[proxy].box = fat;
+		InsertLeaf(proxy);
+		return true;
+	}
+
+	int32_t DynamicAabbTree::AllocateNode()
+	{
+		int32_t node;
+		if (freeList == NullNode)
+		{
+			node = (int32_t)nodes.size();
+			nodes.emplace_back();
+		}
+		else
+		{
+			node = freeList;
+			freeList = nodes[node].parent;
+		}
+
+		auto& n = nodes[node];
+		n.parent = NullNode;
+		n.child1 = NullNode;
+		n.child2 = NullNode;
+		n.height = 0;
+		n.id = 0;
+		return node;
+	}
+
+	void DynamicAabbTree::FreeNode(int32_t node)
+	{
+		nodes[node].parent = freeList;
+		nodes[node].height = -1;
+		freeList = node;
+	}
+
+	void DynamicAabbTree::InsertLeaf(int32_t leaf)
+	{
+		if (root == NullNode)
+		{
+			root = leaf;
+			nodes[root].parent = NullNode;
+			return;
+		}
+
+		// Walk down to the sibling that makes the tree's surface area grow the least
+		const auto leafBox = nodes[leaf].box;
+		auto index = root;
+		while (!nodes[index].IsLeaf())
+		{
+			const auto& node = nodes[index];
+			const float area = node.box.GetSurfaceArea();
+			const float combinedArea = node.box.Merge(leafBox).GetSurfaceArea();
+
+			// Cost of making a new parent for this node and the leaf, and the least that going further down adds to it
+			const float cost = 2 * combinedArea;
+			const float inheritanceCost = 2 * (combinedArea - area);
+
+			float childCosts[2];
+			const int32_t children[2] = { node.child1, node.child2 };
+			for (int i = 0; i < 2; i++)
+			{
+				const auto& child = nodes[children[i]];
+				const float merged = child.box.Merge(leafBox).GetSurfaceArea();
+				childCosts[i] = (child.IsLeaf() ? merged : merged - child.box.GetSurfaceArea()) + inheritanceCost;
+			}
+
+			if (cost < childCosts[0] && cost < childCosts[1])
+			{
+				break;
+			}
+			index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+		}
+		const auto sibling = index;
+
+		// Put a new parent in the sibling's place
+		const auto oldParent = nodes[sibling].parent;
+		const auto newParent = AllocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].box = leafBox.Merge(nodes[sibling].box);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent == NullNode)
+		{
+			root = newParent;
+		}
+		else if (nodes[oldParent].child1 == sibling)
+		{
+			nodes[oldParent].child1 = newParent;
+		}
+		else
+		{
+			nodes[oldParent].child2 = newParent;
+		}
+
+		Refit(nodes[leaf].parent);
+	}
+
+	void DynamicAabbTree::RemoveLeaf(int32_t leaf)
+	{
+		if (leaf == root)
+		{
+			root = NullNode;
+			return;
+		}
+
+		// The sibling takes the parent's place
+		const auto parent = nodes[leaf].parent;
+		const auto grandParent = nodes[parent].parent;
+		const auto sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+		if (grandParent == NullNode)
+		{
+			root = sibling;
+			nodes[sibling].parent = NullNode;
+		}
+		else
+		{
+			if (nodes[grandParent].child1 == parent)
+			{
+				nodes[grandParent].child1 = sibling;
+			}
+			else
+			{
+				nodes[grandParent].child2 = sibling;
+			}
+			nodes[sibling].parent = grandParent;
+			Refit(grandParent);
+		}
+		FreeNode(parent);
+	}
+
+	void DynamicAabbTree::Refit(int32_t node)
+	{
+		while (node != NullNode)
+		{
+			node = Balance(node);
+
+			auto& n = nodes[node];
+			const auto& child1 = nodes[n.child1];
+			const auto& child2 = nodes[n.child2];
+			n.height = 1 + std::max(child1.height, child2.height);
+			n.box = child1.box.Merge(child2.box);
+
+			node = n.parent;
+		}
+	}
+
+	int32_t DynamicAabbTree::Balance(int32_t iA)
+	{
+		auto& A = nodes[iA];
+		if (A.IsLeaf() || A.height < 2)
+		{
+			return iA;
+		}
+
+		const auto iB = A.child1;
+		const auto iC = A.child2;
+		const int balance = nodes[iC].height - nodes[iB].height;
+		if (balance >= -1 && balance <= 1)
+		{
+			return iA;
+		}
+
+		// The taller child (the pivot) moves up into A's place, A takes the pivot's shorter child's place, and the pivot's
+		// taller child stays under it
+		const auto iPivot = balance > 1 ? iC : iB;
+		const auto iOther = balance > 1 ? iB : iC;
+		auto& pivot = nodes[iPivot];
+		const auto iF = pivot.child1;
+		const auto iG = pivot.child2;
+		auto& F = nodes[iF];
+		auto& G = nodes[iG];
+
+		pivot.child1 = iA;
+		pivot.parent = A.parent;
+		A.parent = iPivot;
+		if (pivot.parent == NullNode)
+		{
+			root = iPivot;
+		}
+		else if (nodes[pivot.parent].child1 == iA)
+		{
+			nodes[pivot.parent].child1 = iPivot;
+		}
+		else
+		{
+			nodes[pivot.parent].child2 = iPivot;
+		}
+
+		const auto iTall = F.height > G.height ? iF : iG;
+		const auto iShort = F.height > G.height ? iG : iF;
+		pivot.child2 = iTall;
+		if (balance > 1)
+		{
+			A.child2 = iShort;
+		}
+		else
+		{
+			A.child1 = iShort;
+		}
+		nodes[iShort].parent = iA;
+
+		A.box = nodes[iOther].box.Merge(nodes[iShort].box);
+		A.height = 1 + std::max(nodes[iOther].height, nodes[iShort].height);
+		pivot.box = A.box.Merge(nodes[iTall].box);
+		pivot.height = 1 + std::max(A.height, nodes[iTall].height);
+		return iPivot;
+	}
+}
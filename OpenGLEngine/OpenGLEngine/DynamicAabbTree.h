@@ -0,0 +1,264 @@
+#pragma once
+#include "ECSConfig.h"
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+namespace Reality
+{
+	struct Aabb
+	{
+		Aabb(Vector3 _min = Vector3(0, 0, 0), Vector3 _max = Vector3(0, 0, 0)) : min(_min), max(_max) {}
+		Vector3 min;
+		Vector3 max;
+
+		bool Overlaps(const Aabb& other) const
+		{
+			return min.x < other.max.x && other.min.x < max.x &&
+				min.y < other.max.y && other.min.y < max.y &&
+				min.z < other.max.z && other.min.z < max.z;
+		}
+
+		bool Contains(const Aabb& other) const
+		{
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+				other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+		}
+
+		Aabb Merge(const Aabb& other) const
+		{
+			return Aabb(glm::min(min, other.min), glm::max(max, other.max));
+		}
+
+		float GetSurfaceArea() const
+		{
+			const auto size = max - min;
+			return 2 * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+
+		// Distance along the ray where it enters the box, false if it misses it within maxDistance.
+		// inverseDirection is 1 / direction per axis, infinite for axes the ray doesn't move along.
+		bool RayCast(const Vector3& origin, const Vector3& inverseDirection, float maxDistance, float& distance) const
+		{
+			const auto t1 = (min - origin) * inverseDirection;
+			const auto t2 = (max - origin) * inverseDirection;
+			const auto entries = glm::min(t1, t2);
+			const auto exits = glm::max(t1, t2);
+			const float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+			const float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+			distance = enter;
+			return enter <= exit;
+		}
+	};
+
+	/*
+		Bounding volume hierarchy over boxes that move, the leaves are proxies that carry the id of what they bound
+		(e.g. an entity index).
+
+		Leaves store a box fattened by a margin, and by how far the body just moved, so a body that moves a little stays
+		inside its box and costs nothing. Only when it leaves it is the leaf taken out and inserted again next to the
+		sibling that grows the tree's surface area the least, and the boxes and heights of its ancestors are refit on the
+		way back up. Rotations on that walk keep the tree balanced, so queries stay logarithmic whatever order the bodies
+		are added in and however different their sizes are.
+	*/
+	class DynamicAabbTree
+	{
+	public:
+		static const int32_t NullNode = -1;
+
+		explicit DynamicAabbTree(float _margin = 0.1f) : margin(_margin) {}
+
+		// Adds a leaf for the box and returns its proxy, which stays valid until it is destroyed
+		int32_t CreateProxy(const Aabb& box, uint32_t id);
+		void DestroyProxy(int32_t proxy);
+
+		// Gives a proxy its new tight box, the displacement since the last move stretches the fattened box the way the
+		// body is going. Returns whether the leaf had to be inserted again.
+		bool MoveProxy(int32_t proxy, const Aabb& box, const Vector3& displacement);
+
+		uint32_t GetId(int32_t proxy) const { return nodes[proxy].id; }
+		const Aabb& GetFatAabb(int32_t proxy) const { return nodes[proxy].box; }
+		int GetHeight() const { return root == NullNode ? 0 : nodes[root].height; }
+		int GetProxyCount() const { return proxyCount; }
+
+		// Calls callback(proxy) for every leaf whose fattened box overlaps the box, stops early when it returns false
+		template<typename Callback>
+		void Query(const Aabb& box, Callback callback) const;
+
+		// Calls callback(proxyA, proxyB) once for every two leaves whose fattened boxes overlap. Walks the tree against
+		// itself, so subtrees that are apart are skipped together instead of once per leaf in them.
+		template<typename Callback>
+		void QueryPairs(Callback callback) const;
+
+		// Calls callback(proxy, distance) for every leaf whose fattened box the ray enters within maxDistance, with the
+		// distance where it enters it. The callback returns the distance to clip the ray to: maxDistance to go on,
+		// something shorter once it found a hit closer than that, 0 to stop.
+		// direction has to be normalized.
+		template<typename Callback>
+		void RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, Callback callback) const;
+
+	private:
+		struct Node
+		{
+			Aabb box;
+			int32_t parent;			// next free node while the node is free
+			int32_t child1;
+			int32_t child2;
+			int32_t height;			// 0 for leaves, -1 for free nodes
+			uint32_t id;
+			bool IsLeaf() const { return child1 == NullNode; }
+		};
+
+		// Balanced trees are far less deep than this even with billions of leaves
+		static const int MaxStackSize = 256;
+
+		int32_t AllocateNode();
+		void FreeNode(int32_t node);
+		void InsertLeaf(int32_t leaf);
+		void RemoveLeaf(int32_t leaf);
+		// Refits the boxes and heights from node up to the root, rotating where the subtrees got uneven
+		void Refit(int32_t node);
+		// Rotates the node's taller grandchild up if its children's heights differ by more than one, returns the
+		// subtree's new root
+		int32_t Balance(int32_t node);
+
+		float margin;
+		std::vector<Node> nodes;
+		int32_t root = NullNode;
+		int32_t freeList = NullNode;
+		int proxyCount = 0;
+	};
+
+	template<typename Callback>
+	void DynamicAabbTree::Query(const Aabb& box, Callback callback) const
+	{
+		int32_t stack[MaxStackSize];
+		int size = 0;
+		if (root != NullNode)
+		{
+			stack[size++] = root;
+		}
+
+		while (size > 0)
+		{
+			const auto nodeIndex = stack[--size];
+			const auto& node = nodes[nodeIndex];
+			if (!node.box.Overlaps(box))
+			{
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				if (!callback(nodeIndex))
+				{
+					return;
+				}
+			}
+			else
+			{
+				assert(size + 2 <= MaxStackSize);
+				stack[size++] = node.child1;
+				stack[size++] = node.child2;
+			}
+		}
+	}
+
+	template<typename Callback>
+	void DynamicAabbTree::QueryPairs(Callback callback) const
+	{
+		if (root == NullNode || nodes[root].IsLeaf())
+		{
+			return;
+		}
+
+		// A node stands for the pairs between its two children, a pair of different nodes for the pairs across them
+		struct Task
+		{
+			int32_t a;
+			int32_t b;
+		};
+		std::vector<Task> stack;
+		stack.push_back(Task{ root, root });
+
+		while (!stack.empty())
+		{
+			const auto task = stack.back();
+			stack.pop_back();
+			const auto& a = nodes[task.a];
+
+			if (task.a == task.b)
+			{
+				if (!a.IsLeaf())
+				{
+					stack.push_back(Task{ a.child1, a.child1 });
+					stack.push_back(Task{ a.child2, a.child2 });
+					stack.push_back(Task{ a.child1, a.child2 });
+				}
+				continue;
+			}
+
+			const auto& b = nodes[task.b];
+			if (!a.box.Overlaps(b.box))
+			{
+				continue;
+			}
+
+			if (a.IsLeaf() && b.IsLeaf())
+			{
+				callback(task.a, task.b);
+			}
+			// Split the larger of the two, so both sides shrink at about the same pace
+			else if (b.IsLeaf() || (!a.IsLeaf() && a.box.GetSurfaceArea() > b.box.GetSurfaceArea()))
+			{
+				stack.push_back(Task{ a.child1, task.b });
+				stack.push_back(Task{ a.child2, task.b });
+			}
+			else
+			{
+				stack.push_back(Task{ task.a, b.child1 });
+				stack.push_back(Task{ task.a, b.child2 });
+			}
+		}
+	}
+
+	template<typename Callback>
+	void DynamicAabbTree::RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, Callback callback) const
+	{
+		const Vector3 inverseDirection(1 / direction.x, 1 / direction.y, 1 / direction.z);
+
+		int32_t stack[MaxStackSize];
+		int size = 0;
+		if (root != NullNode)
+		{
+			stack[size++] = root;
+		}
+
+		while (size > 0)
+		{
+			const auto nodeIndex = stack[--size];
+			const auto& node = nodes[nodeIndex];
+			float distance;
+			if (!node.box.RayCast(origin, inverseDirection, maxDistance, distance))
+			{
+				continue;
+			}
+
+			if (node.IsLeaf())
+			{
+				maxDistance = callback(nodeIndex, distance);
+				if (maxDistance <= 0)
+				{
+					return;
+				}
+			}
+			else
+			{
+				assert(size + 2 <= MaxStackSize);
+				stack[size++] = node.child1;
+				stack[size++] = node.child2;
+			}
+		}
+	}
+}
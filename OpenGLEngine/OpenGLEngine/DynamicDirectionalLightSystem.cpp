@@ -7,6 +7,7 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<DynamicDirectionalLightComponent>();
+		requireMainThread();
 		lights.resize(MAX_DIR_LIGHTS);
 	}
 
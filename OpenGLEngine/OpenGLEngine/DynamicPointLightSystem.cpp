@@ -7,6 +7,7 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<DynamicPointLightComponent>();
+		requireMainThread();
 		lights.resize(MAX_POINT_LIGHTS);
 	}
 
@@ -6,6 +6,7 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<DynamicSpotLightComponent>();
+		requireMainThread();
 		lights.resize(MAX_SPOT_LIGHTS);
 	}
 
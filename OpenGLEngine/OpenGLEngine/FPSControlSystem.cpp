@@ -6,6 +6,7 @@ namespace Reality
 	FPSControlSystem::FPSControlSystem()
 	{
 		requireComponent<FPSControlComponent>();
+		requireMainThread();
 	}
 
 
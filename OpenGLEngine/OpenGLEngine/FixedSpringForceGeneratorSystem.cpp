@@ -7,16 +7,14 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<FixedSpringComponent>();
+		requireWriteAccess<ParticleComponent>();
 	}
 
 
 	void FixedSpringForceGeneratorSystem::Update(float deltaTime)
 	{
-		for (auto e : getEntities())
+		view<TransformComponent, FixedSpringComponent>().each([&](ECSEntity e, TransformComponent& transform, FixedSpringComponent& spring)
 		{
-			auto &transform = e.getComponent<TransformComponent>();
-			auto &spring = e.getComponent<FixedSpringComponent>();
-
 			if (spring.entity.hasComponent<TransformComponent>() && 
 				spring.entity.hasComponent<ParticleComponent>())
 			{
@@ -47,7 +45,7 @@ namespace Reality
 				getWorld().data.renderUtil->DrawLine(
 					transform.position, transform.position + length * direction, color);*/
 			}
-		}
+		});
 
 	}
 }
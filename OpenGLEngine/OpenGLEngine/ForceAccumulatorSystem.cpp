@@ -6,16 +6,16 @@ namespace Reality
 	ForceAccumulatorSystem::ForceAccumulatorSystem()
 	{
 		requireComponent<ParticleComponent>();
+		requireWriteAccess<ParticleComponent>();
 	}
 
 
 	void ForceAccumulatorSystem::Update(float deltaTime)
 	{
-		for (auto e : getEntities())
+		view<ParticleComponent>().parallelEach(Mix::DEFAULT_GRAIN_SIZE, [&](ECSEntity e, ParticleComponent& particle)
 		{
-			auto &particle = e.getComponent<ParticleComponent>();
 			particle.accelaration = particle.GetForce() * particle.inverseMass;
 			particle.ResetForceAccumulator();
-		}
+		});
 	}
 }
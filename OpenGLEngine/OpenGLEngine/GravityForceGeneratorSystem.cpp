@@ -6,16 +6,16 @@ namespace Reality
 	GravityForceGeneratorSystem::GravityForceGeneratorSystem()
 	{
 		requireComponent<ParticleComponent>();
+		requireWriteAccess<ParticleComponent>();
 	}
 
 
 	void GravityForceGeneratorSystem::Update(float deltaTime)
 	{
-		for (auto e : getEntities())
+		view<ParticleComponent>().parallelEach(Mix::DEFAULT_GRAIN_SIZE, [&](ECSEntity e, ParticleComponent& particle)
 		{
-			auto &particle = e.getComponent<ParticleComponent>();
 			particle.AddForce(gravity * particle.gravityScale / particle.inverseMass);
-		}
+		});
 
 	}
 }
@@ -0,0 +1,255 @@
+#include "ImplicitSpringSolver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Reality
+{
+	const uint32_t ImplicitSpringSolver::SumBlockSize;
+
+	namespace
+	{
+		double Dot(const Vector3& a, const Vector3& b)
+		{
+			return (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		}
+	}
+
+	template<typename Fn>
+	double ImplicitSpringSolver::Sum(uint32_t count, Mix::ThreadPool& threadPool, Fn fn)
+	{
+		const auto blockCount = (count + SumBlockSize - 1) / SumBlockSize;
+		partialSums.assign(blockCount, 0.0);
+		threadPool.parallelFor(count, SumBlockSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (auto block = begin; block < end; block += SumBlockSize)
+			{
+				partialSums[block / SumBlockSize] = fn(block, std::min(block + SumBlockSize, (uint32_t)end));
+			}
+		});
+
+		double sum = 0;
+		for (auto partial : partialSums)
+		{
+			sum += partial;
+		}
+		return sum;
+	}
+
+	void ImplicitSpringSolver::Solve(const SpringNetwork& network, const std::vector<float>& inverseMasses, const std::vector<Vector3>& velocities,
+		float deltaTime, Mix::ThreadPool& threadPool)
+	{
+		const auto nodeCount = network.GetNodeCount();
+		const auto springCount = network.GetSpringCount();
+		const auto& nodeStart = network.GetNodeStart();
+		const auto& nodeSprings = network.GetNodeSprings();
+		const auto grainSize = Mix::ThreadPool::alignToCacheLines(Mix::DEFAULT_GRAIN_SIZE);
+
+		springBlocks.resize(springCount);
+		coupled.resize(springCount);
+		masses.resize(nodeCount);
+		preconditioner.resize(nodeCount);
+		// The last step's velocity changes are a good first guess, as long as the nodes are the same
+		const bool warmStart = warmStarting && dv.size() == nodeCount;
+		if (!warmStart)
+		{
+			dv.assign(nodeCount, Vector3(0, 0, 0));
+		}
+		r.resize(nodeCount);
+		z.resize(nodeCount);
+		p.resize(nodeCount);
+		ap.resize(nodeCount);
+		iterations = 0;
+		residual = 0;
+
+		threadPool.parallelFor(springCount, grainSize, [&](unsigned int begin, unsigned int end)
+		{
+			ComputeBlocks(network, deltaTime, begin, end);
+		});
+
+		// Right hand side, and the diagonal blocks for the preconditioner. Nodes that don't move are rows of zeros.
+		const auto rhsSquared = Sum(nodeCount, threadPool, [&](uint32_t begin, uint32_t end)
+		{
+			double sum = 0;
+			for (auto node = begin; node < end; node++)
+			{
+				const bool moves = inverseMasses[node] > 0 && nodeStart[node] != nodeStart[node + 1];
+				masses[node] = moves ? 1 / inverseMasses[node] : 0.0f;
+				if (!moves)
+				{
+					dv[node] = Vector3(0, 0, 0);
+					r[node] = Vector3(0, 0, 0);
+					preconditioner[node] = Block{ 0, 0, 0, 0, 0, 0 };
+					continue;
+				}
+
+				Block diagonal{ masses[node], 0, 0, masses[node], 0, masses[node] };
+				Vector3 rhs = deltaTime * network.GetNodeForce(node);
+				for (auto k = nodeStart[node]; k < nodeStart[node + 1]; k++)
+				{
+					const auto spring = nodeSprings[k] >> 1;
+					const auto other = (nodeSprings[k] & 1) ? network.GetB(spring) : network.GetA(spring);
+					const auto& block = springBlocks[spring];
+					diagonal.xx += block.xx;
+					diagonal.xy += block.xy;
+					diagonal.xz += block.xz;
+					diagonal.yy += block.yy;
+					diagonal.yz += block.yz;
+					diagonal.zz += block.zz;
+					rhs -= block * (velocities[node] - velocities[other]);
+				}
+
+				// Inverse of the symmetric block from its cofactors, the mass keeps it from being singular
+				Block inverse;
+				inverse.xx = diagonal.yy * diagonal.zz - diagonal.yz * diagonal.yz;
+				inverse.xy = diagonal.xz * diagonal.yz - diagonal.xy * diagonal.zz;
+				inverse.xz = diagonal.xy * diagonal.yz - diagonal.xz * diagonal.yy;
+				inverse.yy = diagonal.xx * diagonal.zz - diagonal.xz * diagonal.xz;
+				inverse.yz = diagonal.xy * diagonal.xz - diagonal.xx * diagonal.yz;
+				inverse.zz = diagonal.xx * diagonal.yy - diagonal.xy * diagonal.xy;
+				const float inverseDeterminant = 1 / (diagonal.xx * inverse.xx + diagonal.xy * inverse.xy + diagonal.xz * inverse.xz);
+				preconditioner[node] = Block{ inverse.xx * inverseDeterminant, inverse.xy * inverseDeterminant, inverse.xz * inverseDeterminant,
+					inverse.yy * inverseDeterminant, inverse.yz * inverseDeterminant, inverse.zz * inverseDeterminant };
+
+				r[node] = rhs;
+				sum += Dot(rhs, rhs);
+			}
+			return sum;
+		});
+		if (rhsSquared <= 0)
+		{
+			dv.assign(nodeCount, Vector3(0, 0, 0));
+			return;
+		}
+
+		auto rz = Sum(nodeCount, threadPool, [&](uint32_t begin, uint32_t end)
+		{
+			double sum = 0;
+			if (warmStart)
+			{
+				Multiply(network, dv, ap, begin, end);
+			}
+			for (auto node = begin; node < end; node++)
+			{
+				if (warmStart)
+				{
+					r[node] -= ap[node];
+				}
+				z[node] = preconditioner[node] * r[node];
+				p[node] = z[node];
+				sum += Dot(r[node], z[node]);
+			}
+			return sum;
+		});
+
+		const double target = (double)tolerance * tolerance * rhsSquared;
+		double residualSquared = rhsSquared;
+		while (iterations < maxIterations)
+		{
+			const auto pAp = Sum(nodeCount, threadPool, [&](uint32_t begin, uint32_t end)
+			{
+				Multiply(network, p, ap, begin, end);
+				double sum = 0;
+				for (auto node = begin; node < end; node++)
+				{
+					sum += Dot(p[node], ap[node]);
+				}
+				return sum;
+			});
+			if (pAp <= 0)
+			{
+				break;
+			}
+
+			const auto alpha = (float)(rz / pAp);
+			residualSquared = Sum(nodeCount, threadPool, [&](uint32_t begin, uint32_t end)
+			{
+				double sum = 0;
+				for (auto node = begin; node < end; node++)
+				{
+					dv[node] += alpha * p[node];
+					r[node] -= alpha * ap[node];
+					sum += Dot(r[node], r[node]);
+				}
+				return sum;
+			});
+			iterations++;
+			if (residualSquared <= target)
+			{
+				break;
+			}
+
+			const auto rzNext = Sum(nodeCount, threadPool, [&](uint32_t begin, uint32_t end)
+			{
+				double sum = 0;
+				for (auto node = begin; node < end; node++)
+				{
+					z[node] = preconditioner[node] * r[node];
+					sum += Dot(r[node], z[node]);
+				}
+				return sum;
+			});
+			const auto beta = (float)(rzNext / rz);
+			rz = rzNext;
+
+			threadPool.parallelFor(nodeCount, grainSize, [&](unsigned int begin, unsigned int end)
+			{
+				for (auto node = begin; node < end; node++)
+				{
+					p[node] = z[node] + beta * p[node];
+				}
+			});
+		}
+		residual = (float)std::sqrt(residualSquared / rhsSquared);
+	}
+
+	void ImplicitSpringSolver::ComputeBlocks(const SpringNetwork& network, float deltaTime, uint32_t begin, uint32_t end)
+	{
+		for (auto spring = begin; spring < end; spring++)
+		{
+			const auto flags = network.GetFlags(spring);
+			coupled[spring] = (flags & SpringNetwork::PushA) && (flags & SpringNetwork::PushB) ? 1 : 0;
+
+			const auto delta = network.GetPosition(network.GetA(spring)) - network.GetPosition(network.GetB(spring));
+			const float length = glm::length(delta);
+			const float restLength = network.GetRestLength(spring);
+			// Slack bungees have no force to change, springs whose ends are in the same place no direction
+			if (flags == 0 || length <= 0 || ((flags & SpringNetwork::TensionOnly) && length <= restLength))
+			{
+				springBlocks[spring] = Block{ 0, 0, 0, 0, 0, 0 };
+				continue;
+			}
+
+			// k (n n^T + (1 - rest / length) (I - n n^T)), without the sideways part for compressed springs
+			const auto n = delta / length;
+			const float sideways = std::max(1 - restLength / length, 0.0f);
+			const float scale = deltaTime * deltaTime * network.GetSpringConstant(spring);
+			const float along = scale * (1 - sideways);
+			const float across = scale * sideways;
+			springBlocks[spring] = Block{ along * n.x * n.x + across, along * n.x * n.y, along * n.x * n.z,
+				along * n.y * n.y + across, along * n.y * n.z, along * n.z * n.z + across };
+		}
+	}
+
+	void ImplicitSpringSolver::Multiply(const SpringNetwork& network, const std::vector<Vector3>& x, std::vector<Vector3>& y, uint32_t begin, uint32_t end) const
+	{
+		const auto& nodeStart = network.GetNodeStart();
+		const auto& nodeSprings = network.GetNodeSprings();
+		for (auto node = begin; node < end; node++)
+		{
+			if (masses[node] == 0)
+			{
+				y[node] = Vector3(0, 0, 0);
+				continue;
+			}
+
+			Vector3 product = masses[node] * x[node];
+			for (auto k = nodeStart[node]; k < nodeStart[node + 1]; k++)
+			{
+				const auto spring = nodeSprings[k] >> 1;
+				const auto other = (nodeSprings[k] & 1) ? network.GetB(spring) : network.GetA(spring);
+				product += springBlocks[spring] * (coupled[spring] ? x[node] - x[other] : x[node]);
+			}
+			y[node] = product;
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "SpringNetwork.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Backward Euler step for the nodes of a spring network, so stiff springs stay stable at a full fixed step
+		instead of needing many small ones.
+
+		Finds the velocity change dv of the step from
+			(M + h^2 J) dv = h f - h^2 J v
+		where f are the spring forces at the current positions, v the current velocities and J the springs' stiffness
+		(the negated Jacobian of their forces, with compressed springs' sideways part dropped so it stays positive
+		semidefinite). Springs that only push one of their ends don't couple it to the other one, which keeps the
+		system symmetric.
+
+		J is never assembled: every product walks the springs of each node in the network's per node lists, with one
+		3x3 block per spring computed once per step. The system is solved by conjugate gradients preconditioned with
+		the inverse 3x3 diagonal blocks. The nodes are split into ranges on the thread pool, every node is written by
+		one range, and dot products are summed over fixed size blocks in order, so the result doesn't depend on the
+		number of threads.
+	*/
+	class ImplicitSpringSolver
+	{
+	public:
+		int maxIterations = 50;
+		// Stops once the residual is this much smaller than the right hand side
+		float tolerance = 1e-3f;
+		// Starts from the last solve's velocity changes instead of zero
+		bool warmStarting = true;
+
+		// Nodes with no inverse mass, or that no spring pushes, keep their velocity. The network's forces have to be
+		// computed for its current positions.
+		void Solve(const SpringNetwork& network, const std::vector<float>& inverseMasses, const std::vector<Vector3>& velocities,
+			float deltaTime, Mix::ThreadPool& threadPool);
+
+		const std::vector<Vector3>& GetVelocityChanges() const { return dv; }
+		int GetIterations() const { return iterations; }
+		// Residual relative to the right hand side when the last solve stopped
+		float GetResidual() const { return residual; }
+
+	private:
+		// Symmetric 3x3 block
+		struct Block
+		{
+			float xx, xy, xz, yy, yz, zz;
+			Vector3 operator*(const Vector3& v) const
+			{
+				return Vector3(xx * v.x + xy * v.y + xz * v.z, xy * v.x + yy * v.y + yz * v.z, xz * v.x + yz * v.y + zz * v.z);
+			}
+		};
+
+		// h^2 J of every spring, and whether it couples its ends
+		void ComputeBlocks(const SpringNetwork& network, float deltaTime, uint32_t begin, uint32_t end);
+		// (M + h^2 J) x for nodes [begin, end)
+		void Multiply(const SpringNetwork& network, const std::vector<Vector3>& x, std::vector<Vector3>& y, uint32_t begin, uint32_t end) const;
+		// Sum of fn(begin, end) over blocks of SumBlockSize nodes, added in block order
+		template<typename Fn>
+		double Sum(uint32_t count, Mix::ThreadPool& threadPool, Fn fn);
+
+		static const uint32_t SumBlockSize = 1024;
+
+		std::vector<Block> springBlocks;
+		std::vector<uint8_t> coupled;
+		std::vector<float> masses;
+		std::vector<Block> preconditioner;
+
+		std::vector<Vector3> dv;
+		std::vector<Vector3> r;
+		std::vector<Vector3> z;
+		std::vector<Vector3> p;
+		std::vector<Vector3> ap;
+		std::vector<double> partialSums;
+
+		int iterations = 0;
+		float residual = 0;
+	};
+}
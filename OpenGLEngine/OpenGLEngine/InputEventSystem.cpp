@@ -7,6 +7,7 @@ namespace Reality
 {
 	InputEventSystem::InputEventSystem()
 	{
+		requireMainThread();
 	}
 
 	void InputEventSystem::Update(float deltaTime)
@@ -0,0 +1,107 @@
+#include "IslandBuilder.h"
+#include <algorithm>
+#include <cassert>
+
+namespace Reality
+{
+	namespace
+	{
+		const uint32_t NoIsland = 0xffffffffu;
+	}
+
+	void IslandBuilder::Reset(uint32_t bodyCount)
+	{
+		parents.resize(bodyCount);
+		for (uint32_t body = 0; body < bodyCount; body++)
+		{
+			parents[body] = body;
+		}
+		sizes.assign(bodyCount, 1);
+		constraintBodies.clear();
+	}
+
+	void IslandBuilder::AddConstraint(uint32_t a, uint32_t b)
+	{
+		assert(a != 0 || b != 0);
+		if (a != 0 && b != 0)
+		{
+			Join(a, b);
+		}
+		constraintBodies.push_back(a != 0 ? a : b);
+	}
+
+	void IslandBuilder::Build()
+	{
+		// Number the islands as they are first seen and count their constraints
+		islandOf.assign(parents.size(), NoIsland);
+		counts.clear();
+		constraintIslands.resize(constraintBodies.size());
+		for (uint32_t constraint = 0; constraint < constraintBodies.size(); constraint++)
+		{
+			const auto root = Find(constraintBodies[constraint]);
+			if (islandOf[root] == NoIsland)
+			{
+				islandOf[root] = (uint32_t)counts.size();
+				counts.push_back(0);
+			}
+			constraintIslands[constraint] = islandOf[root];
+			counts[islandOf[root]]++;
+		}
+
+		// Largest first, so the long solves start before the short ones
+		order.resize(counts.size());
+		for (uint32_t island = 0; island < order.size(); island++)
+		{
+			order[island] = island;
+		}
+		std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+			return counts[a] > counts[b];
+		});
+
+		islands.resize(counts.size());
+		starts.resize(counts.size());
+		uint32_t first = 0;
+		for (uint32_t i = 0; i < order.size(); i++)
+		{
+			islands[i] = Island{ first, counts[order[i]] };
+			starts[order[i]] = first;
+			first += counts[order[i]];
+		}
+
+		// Counting sort of the constraints into their islands, in the order they were added
+		islandConstraints.resize(constraintBodies.size());
+		for (uint32_t constraint = 0; constraint < constraintBodies.size(); constraint++)
+		{
+			islandConstraints[starts[constraintIslands[constraint]]++] = constraint;
+		}
+	}
+
+	uint32_t IslandBuilder::Find(uint32_t body)
+	{
+		// Path halving, every other body on the way up points to its grandparent afterwards
+		while (parents[body] != body)
+		{
+			parents[body] = parents[parents[body]];
+			body = parents[body];
+		}
+		return body;
+	}
+
+	void IslandBuilder::Join(uint32_t a, uint32_t b)
+	{
+		a = Find(a);
+		b = Find(b);
+		if (a == b)
+		{
+			return;
+		}
+
+		// The smaller tree goes under the larger one, so the trees stay shallow
+		if (sizes[a] < sizes[b])
+		{
+			std::swap(a, b);
+		}
+		parents[b] = a;
+		sizes[a] += sizes[b];
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Splits bodies and the constraints between them into islands that don't touch each other, with union-find over
+		the bodies. Islands can be solved on their own, in any order or at the same time.
+
+		Body 0 is the static world (walls, anything that can't move): it is in every island that touches it but doesn't
+		join them, since nothing it does depends on the other islands.
+	*/
+	class IslandBuilder
+	{
+	public:
+		struct Island
+		{
+			// the island's constraints are GetConstraints()[first, first + count)
+			uint32_t first;
+			uint32_t count;
+		};
+
+		void Reset(uint32_t bodyCount);
+		// Adds a constraint between two bodies, at least one of them not static. Constraints are numbered in the order
+		// they are added.
+		void AddConstraint(uint32_t a, uint32_t b);
+		// Groups the constraints by island, largest island first. Constraints keep their order within an island.
+		void Build();
+
+		const std::vector<Island>& GetIslands() const { return islands; }
+		const std::vector<uint32_t>& GetConstraints() const { return islandConstraints; }
+
+	private:
+		uint32_t Find(uint32_t body);
+		void Join(uint32_t a, uint32_t b);
+
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> sizes;
+		// a body of each constraint that isn't the static one
+		std::vector<uint32_t> constraintBodies;
+		std::vector<uint32_t> constraintIslands;
+
+		// island of each root body, index = body
+		std::vector<uint32_t> islandOf;
+		// constraints per island and the islands by size, index = island in the order first seen
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> order;
+		std::vector<uint32_t> starts;
+
+		std::vector<Island> islands;
+		std::vector<uint32_t> islandConstraints;
+	};
+}
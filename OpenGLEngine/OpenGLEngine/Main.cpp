@@ -7,17 +7,22 @@
 #include "GravityForceGeneratorSystem.h"
 #include "FixedSpringForceGeneratorSystem.h"
 #include "ForceAccumulatorSystem.h"
+#include "ParticleIntegrationSystem.h"
 #include "PairedSpringForceGeneratorSystem.h"
 #include "SphereContactGeneratorSystem.h"
 #include "ParticleContactResolutionSystem.h"
+#include "ParticleSleepSystem.h"
 #include "CableComponentSystem.h"
 #include "RodSystem.h"
+#include "DistanceConstraintSystem.h"
 #include "FPSControlSystem.h"
 #include "DynamicDirectionalLightSystem.h"
 #include "DynamicPointLightSystem.h"
 #include "DynamicSpotLightSystem.h"
 #include "BungeeForceGeneratorSystem.h"
+#include "SpringNetworkSystem.h"
 #include "BuoyancyForceGeneratorSystem.h"
+#include "Benchmarks.h"
 #include <string>
 #include <stdlib.h>     
 #include <time.h>       
@@ -38,8 +43,14 @@ void MakeACable(ECSWorld& world);
 void MakeCablesAndRods(ECSWorld& world);
 void SetupLights(ECSWorld& world);
 
-int main()
+int main(int argc, char* argv[])
 {
+	// A benchmark named on the command line runs instead of the scene
+	if (argc > 1)
+	{
+		return RunBenchmark(argv[1]) ? 0 : 1;
+	}
+
 	ECSWorld world;
 
 	// Init and Load
@@ -72,21 +83,17 @@ int main()
 	world.getSystemManager().addSystem<RenderingSystem>();
 	world.getSystemManager().addSystem<InputEventSystem>();
 	world.getSystemManager().addSystem<RotateSystem>();
-	world.getSystemManager().addSystem<ParticleSystem>();
 	world.getSystemManager().addSystem<ParticleSpawnerSystem>();
-	world.getSystemManager().addSystem<GravityForceGeneratorSystem>();
-	world.getSystemManager().addSystem<FixedSpringForceGeneratorSystem>();
-	world.getSystemManager().addSystem<PairedSpringForceGeneratorSystem>();
+	world.getSystemManager().addSystem<SpringNetworkSystem>();
 	world.getSystemManager().addSystem<SphereContactGeneratorSystem>();
-	world.getSystemManager().addSystem<CableComponentSystem>();
-	world.getSystemManager().addSystem<RodSystem>();
+	world.getSystemManager().addSystem<DistanceConstraintSystem>();
 	world.getSystemManager().addSystem<ParticleContactResolutionSystem>();
-	world.getSystemManager().addSystem<ForceAccumulatorSystem>();
+	world.getSystemManager().addSystem<ParticleSleepSystem>();
+	world.getSystemManager().addSystem<ParticleIntegrationSystem>();
 	world.getSystemManager().addSystem<FPSControlSystem>();
 	world.getSystemManager().addSystem<DynamicDirectionalLightSystem>();
 	world.getSystemManager().addSystem<DynamicPointLightSystem>();
 	world.getSystemManager().addSystem<DynamicSpotLightSystem>();
-	world.getSystemManager().addSystem<BungeeForceGeneratorSystem>();
 	world.getSystemManager().addSystem<BuoyancyForceGeneratorSystem>();
 
 	float time = glfwGetTime();
@@ -124,38 +131,50 @@ int main()
 			//LoadModels(world);
 			modelsLoadStarted = true;
 		}
+		// Physics
+		//float fixedDeltaTime = glfwGetKey(world.data.renderUtil->window->glfwWindow, GLFW_KEY_SPACE) == GLFW_PRESS ? 1 / 60.0f : 0;		
+		float fixedDeltaTime = 1 / 60.0f;
+		// Creates entities when B is pressed, so nothing runs next to it. It only adds forces, which the integration
+		// sums whenever they come, so it goes first where it holds nothing up.
+		world.getSystemManager().schedule<BuoyancyForceGeneratorSystem>(fixedDeltaTime);
+
 		// Process Input
-		world.getSystemManager().getSystem<InputEventSystem>().Update(deltaTime);
+		world.getSystemManager().schedule<InputEventSystem>(deltaTime);
 
 		// Game Logic Update
-		world.getSystemManager().getSystem<FPSControlSystem>().Update(deltaTime);
-		world.getSystemManager().getSystem<RotateSystem>().Update(deltaTime);
-		world.getSystemManager().getSystem<ParticleSpawnerSystem>().Update(deltaTime);
+		world.getSystemManager().schedule<FPSControlSystem>(deltaTime);
+		world.getSystemManager().schedule<RotateSystem>(deltaTime);
+		world.getSystemManager().schedule<ParticleSpawnerSystem>(deltaTime);
 
-		// Physics
-		//float fixedDeltaTime = glfwGetKey(world.data.renderUtil->window->glfwWindow, GLFW_KEY_SPACE) == GLFW_PRESS ? 1 / 60.0f : 0;		
-		float fixedDeltaTime = 1 / 60.0f;
 		// Force Generators
-		world.getSystemManager().getSystem<GravityForceGeneratorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<FixedSpringForceGeneratorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<PairedSpringForceGeneratorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<BungeeForceGeneratorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<BuoyancyForceGeneratorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<ForceAccumulatorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<ParticleSystem>().Update(fixedDeltaTime);
+		// Paired springs, bungees and fixed springs
+		world.getSystemManager().schedule<SpringNetworkSystem>(fixedDeltaTime);
+		// Gravity, accumulation and integration in one pass
+		world.getSystemManager().schedule<ParticleIntegrationSystem>(fixedDeltaTime);
+		// Rods and cables, redoing the integration in substeps
+		world.getSystemManager().schedule<DistanceConstraintSystem>(fixedDeltaTime);
 
 		// Physics Solvers
 
-		world.getSystemManager().getSystem<SphereContactGeneratorSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<CableComponentSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<RodSystem>().Update(fixedDeltaTime);
-		world.getSystemManager().getSystem<ParticleContactResolutionSystem>().Update(fixedDeltaTime);
+		world.getSystemManager().schedule<SphereContactGeneratorSystem>(fixedDeltaTime);
+		// Sleeping particles that moving ones ran into wake before the contacts are solved, so they take the hit
+		auto& sleepSystem = world.getSystemManager().getSystem<ParticleSleepSystem>();
+		world.getSystemManager().schedule(sleepSystem, [&sleepSystem]() { sleepSystem.WakeTouched(); });
+		world.getSystemManager().schedule<ParticleContactResolutionSystem>(fixedDeltaTime);
+		world.getSystemManager().schedule<ParticleSleepSystem>(fixedDeltaTime);
 
 		// Rendering Update
-		world.getSystemManager().getSystem<DynamicDirectionalLightSystem>().Update(deltaTime);
-		world.getSystemManager().getSystem<DynamicPointLightSystem>().Update(deltaTime);
-		world.getSystemManager().getSystem<DynamicSpotLightSystem>().Update(deltaTime);
-		world.getSystemManager().getSystem<RenderingSystem>().Update(deltaTime);
+		world.getSystemManager().schedule<DynamicDirectionalLightSystem>(deltaTime);
+		world.getSystemManager().schedule<DynamicPointLightSystem>(deltaTime);
+		world.getSystemManager().schedule<DynamicSpotLightSystem>(deltaTime);
+		world.getSystemManager().schedule<RenderingSystem>(deltaTime);
+
+		// Run the systems, the ones that touch different data run at the same time. Only the start of the frame
+		// overlaps: input and the camera run on this thread next to RotateSystem, then the spawner next to the springs.
+		// From the integration on every system writes or reads what the one before wrote, down to the lights and the
+		// rendering, so the physics only runs in parallel inside each system. The "scheduler" benchmark prints which
+		// systems can run next to which.
+		world.getSystemManager().runScheduled();
 
 		elapsedDeltaTime = glfwGetTime() - time;
 		logicDelta = elapsedDeltaTime - world.data.renderUtil->GetRenderDelta();
@@ -496,4 +515,4 @@ void MakeABunchaBuoyancy(ECSWorld& world)
 		b.addComponent<TransformComponent>(pos, scale);
 		b.addComponent<BuoyancyComponent>(scale.y * 0.5f, 10, scale.y, 100, entity);
 	}
-}
\ No newline at end of file
+}
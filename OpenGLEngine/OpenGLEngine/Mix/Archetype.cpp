@@ -0,0 +1,201 @@
+#include "Archetype.h"
+#include <algorithm>
+
+namespace Mix
+{
+
+namespace
+{
+
+std::size_t alignUp(std::size_t offset, std::size_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+}
+
+Archetype::Archetype(const ComponentMask &mask, const std::vector<ComponentInfo> &infos) : mask(mask)
+{
+    std::fill(std::begin(columnOf), std::end(columnOf), (int8_t)-1);
+    std::fill(std::begin(addEdges), std::end(addEdges), nullptr);
+    std::fill(std::begin(removeEdges), std::end(removeEdges), nullptr);
+
+    std::size_t rowSize = sizeof(Index);
+    for (std::size_t id = 0; id < mask.size(); ++id) {
+        if (mask.test(id)) {
+            assert(infos[id].size > 0);
+            columnOf[id] = (int8_t)columns.size();
+            columns.push_back({ (BaseComponent::Id)id, 0, infos[id] });
+            rowSize += infos[id].size;
+        }
+    }
+
+    // start from the unpadded estimate and shrink until the aligned columns fit in a chunk
+    capacity = (uint32_t)std::max<std::size_t>(ARCHETYPE_CHUNK_SIZE / rowSize, 1);
+    while (true) {
+        std::size_t offset = sizeof(Index) * capacity;
+        for (auto &column : columns) {
+            offset = alignUp(offset, column.info.alignment);
+            column.offset = offset;
+            offset += column.info.size * capacity;
+        }
+        if (offset <= ARCHETYPE_CHUNK_SIZE || capacity == 1) {
+            break;
+        }
+        --capacity;
+    }
+}
+
+Archetype::~Archetype()
+{
+    for (uint32_t chunk = 0; chunk < chunks.size(); ++chunk) {
+        for (uint32_t row = 0; row < chunks[chunk].count; ++row) {
+            for (const auto &column : columns) {
+                column.info.destroy(getComponent(column.id, chunk, row));
+            }
+        }
+    }
+}
+
+uint32_t Archetype::getSize() const
+{
+    if (chunks.empty()) {
+        return 0;
+    }
+    return (uint32_t)(chunks.size() - 1) * capacity + chunks.back().count;
+}
+
+void* Archetype::getComponent(BaseComponent::Id id, uint32_t chunk, uint32_t row) const
+{
+    const auto column = columnOf[id];
+    assert(column >= 0);
+    assert(chunk < chunks.size() && row < chunks[chunk].count);
+    const auto &info = columns[column];
+    return chunks[chunk].memory.get() + info.offset + row * info.info.size;
+}
+
+Archetype::Index* Archetype::getMutableIndices(uint32_t chunk)
+{
+    return reinterpret_cast<Index*>(chunks[chunk].memory.get());
+}
+
+void Archetype::allocate(Index index, uint32_t &chunk, uint32_t &row)
+{
+    if (chunks.empty() || chunks.back().count == capacity) {
+        Chunk newChunk;
+        newChunk.memory.reset(new unsigned char[ARCHETYPE_CHUNK_SIZE]);
+        chunks.push_back(std::move(newChunk));
+    }
+
+    chunk = (uint32_t)chunks.size() - 1;
+    row = chunks[chunk].count++;
+    getMutableIndices(chunk)[row] = index;
+}
+
+Archetype::Index Archetype::release(uint32_t chunk, uint32_t row)
+{
+    const auto lastChunk = (uint32_t)chunks.size() - 1;
+    const auto lastRow = chunks[lastChunk].count - 1;
+    auto moved = getIndices(chunk)[row];
+
+    if (chunk != lastChunk || row != lastRow) {
+        for (const auto &column : columns) {
+            void *last = getComponent(column.id, lastChunk, lastRow);
+            column.info.moveConstruct(getComponent(column.id, chunk, row), last);
+            column.info.destroy(last);
+        }
+        moved = getIndices(lastChunk)[lastRow];
+        getMutableIndices(chunk)[row] = moved;
+    }
+
+    if (--chunks[lastChunk].count == 0) {
+        chunks.pop_back();
+    }
+
+    return moved;
+}
+
+void ArchetypeStorage::destroy(Index index)
+{
+    if (index >= locations.size() || !locations[index].archetype) {
+        return;
+    }
+
+    move(index, nullptr);
+}
+
+ArchetypeStorage::Location& ArchetypeStorage::getLocation(Index index)
+{
+    if (index >= locations.size()) {
+        locations.resize(index + 1);
+    }
+    return locations[index];
+}
+
+Archetype* ArchetypeStorage::getArchetype(const ComponentMask &mask)
+{
+    if (mask.none()) {
+        return nullptr;
+    }
+
+    auto it = archetypesByMask.find(mask);
+    if (it != archetypesByMask.end()) {
+        return it->second;
+    }
+
+    archetypes.emplace_back(new Archetype(mask, infos));
+    auto archetype = archetypes.back().get();
+    archetypesByMask.emplace(mask, archetype);
+    return archetype;
+}
+
+Archetype* ArchetypeStorage::getNeighbour(Archetype *archetype, BaseComponent::Id id, bool add)
+{
+    if (!archetype) {
+        ComponentMask mask;
+        mask.set(id, add);
+        return getArchetype(mask);
+    }
+
+    auto &edge = add ? archetype->addEdges[id] : archetype->removeEdges[id];
+    if (!edge) {
+        auto mask = archetype->getMask();
+        mask.set(id, add);
+        edge = getArchetype(mask);
+    }
+    return edge;
+}
+
+void ArchetypeStorage::move(Index index, Archetype *target)
+{
+    auto &location = getLocation(index);
+    auto source = location.archetype;
+    assert(source != target);
+
+    uint32_t chunk = 0, row = 0;
+    if (target) {
+        target->allocate(index, chunk, row);
+    }
+
+    if (source) {
+        for (const auto &column : source->columns) {
+            void *component = source->getComponent(column.id, location.chunk, location.row);
+            if (target && target->getMask().test(column.id)) {
+                column.info.moveConstruct(target->getComponent(column.id, chunk, row), component);
+            }
+            column.info.destroy(component);
+        }
+
+        const auto moved = source->release(location.chunk, location.row);
+        if (moved != index) {
+            locations[moved].chunk = location.chunk;
+            locations[moved].row = location.row;
+        }
+    }
+
+    location.archetype = target;
+    location.chunk = chunk;
+    location.row = row;
+}
+
+}
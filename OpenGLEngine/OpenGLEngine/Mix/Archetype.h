@@ -0,0 +1,209 @@
+#pragma once
+
+#include "Config.h"
+#include "Component.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+namespace Mix
+{
+
+// What the archetype storage needs to know about a component type to move it between chunks without knowing the type.
+struct ComponentInfo
+{
+    std::size_t size = 0;
+    std::size_t alignment = 0;
+    void (*moveConstruct)(void *destination, void *source) = nullptr;
+    void (*destroy)(void *object) = nullptr;
+};
+
+/*
+    An archetype holds every entity that has exactly the same set of components.
+
+    Entities are stored in fixed-size chunks (ARCHETYPE_CHUNK_SIZE bytes). Each chunk starts with a column of entity
+    indices followed by one contiguous column per component type, so iterating a component of an archetype walks
+    plain arrays. Rows are kept dense: removing a row moves the archetype's last row into the hole.
+*/
+class Archetype
+{
+public:
+    using Index = uint32_t;
+
+    Archetype(const ComponentMask &mask, const std::vector<ComponentInfo> &infos);
+    ~Archetype();
+
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    const ComponentMask& getMask() const { return mask; }
+
+    // total number of entities in the archetype
+    uint32_t getSize() const;
+
+    // maximum number of entities per chunk
+    uint32_t getCapacity() const { return capacity; }
+
+    uint32_t getChunkCount() const { return (uint32_t)chunks.size(); }
+    uint32_t getChunkSize(uint32_t chunk) const { return chunks[chunk].count; }
+
+    // column of entity indices of a chunk
+    const Index* getIndices(uint32_t chunk) const
+    {
+        return reinterpret_cast<const Index*>(chunks[chunk].memory.get());
+    }
+
+    // column of components of type T of a chunk
+    template <typename T>
+    T* getColumn(uint32_t chunk) const
+    {
+        const auto column = columnOf[Component<T>::getId()];
+        assert(column >= 0);
+        return reinterpret_cast<T*>(chunks[chunk].memory.get() + columns[column].offset);
+    }
+
+private:
+    struct Column
+    {
+        BaseComponent::Id id;
+        std::size_t offset;
+        ComponentInfo info;
+    };
+
+    struct Chunk
+    {
+        std::unique_ptr<unsigned char[]> memory;
+        uint32_t count = 0;
+    };
+
+    void* getComponent(BaseComponent::Id id, uint32_t chunk, uint32_t row) const;
+    Index* getMutableIndices(uint32_t chunk);
+
+    // appends an uninitialized row for the entity index
+    void allocate(Index index, uint32_t &chunk, uint32_t &row);
+
+    // fills the hole at (chunk, row) with the last row, the components at the hole must already be destroyed.
+    // returns the index of the entity that was moved into the hole (or the removed index if nothing moved).
+    Index release(uint32_t chunk, uint32_t row);
+
+    ComponentMask mask;
+    std::vector<Column> columns;
+    int8_t columnOf[MAX_COMPONENTS];
+    uint32_t capacity = 0;
+    std::vector<Chunk> chunks;
+
+    // cached neighbour archetypes, index = component id
+    Archetype *addEdges[MAX_COMPONENTS];
+    Archetype *removeEdges[MAX_COMPONENTS];
+
+    friend class ArchetypeStorage;
+};
+
+// Keeps track of all the archetypes and of which archetype, chunk and row each entity lives in.
+class ArchetypeStorage
+{
+public:
+    using Index = uint32_t;
+
+    ArchetypeStorage() : infos(MAX_COMPONENTS) {}
+
+    ArchetypeStorage(const ArchetypeStorage&) = delete;
+    ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+    // adds the component to the entity (moving it to a new archetype), or overwrites it if the entity already has one
+    template <typename T> T& set(Index index, T component);
+
+    // removes the component from the entity, moving it to the archetype without that component
+    template <typename T> void remove(Index index);
+
+    template <typename T> T& get(Index index) const;
+
+    // destroys all the components of an entity
+    void destroy(Index index);
+
+    const std::vector<std::unique_ptr<Archetype>>& getArchetypes() const { return archetypes; }
+
+private:
+    struct Location
+    {
+        Archetype *archetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+    };
+
+    template <typename T> void accommodateComponent();
+
+    Location& getLocation(Index index);
+    Archetype* getArchetype(const ComponentMask &mask);
+    Archetype* getNeighbour(Archetype *archetype, BaseComponent::Id id, bool add);
+
+    // moves an entity to another archetype (nullptr = no components).
+    // components missing from the target are destroyed, components missing from the source are left unconstructed.
+    void move(Index index, Archetype *target);
+
+    std::vector<ComponentInfo> infos;
+    std::vector<Location> locations;
+    std::unordered_map<ComponentMask, Archetype*> archetypesByMask;
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+};
+
+template <typename T>
+T& ArchetypeStorage::set(Index index, T component)
+{
+    accommodateComponent<T>();
+    const auto componentId = Component<T>::getId();
+    auto &location = getLocation(index);
+
+    if (location.archetype && location.archetype->getMask().test(componentId)) {
+        auto &existing = *static_cast<T*>(location.archetype->getComponent(componentId, location.chunk, location.row));
+        existing = std::move(component);
+        return existing;
+    }
+
+    move(index, getNeighbour(location.archetype, componentId, true));
+    void *memory = location.archetype->getComponent(componentId, location.chunk, location.row);
+    return *new (memory) T(std::move(component));
+}
+
+template <typename T>
+void ArchetypeStorage::remove(Index index)
+{
+    const auto componentId = Component<T>::getId();
+    auto &location = getLocation(index);
+
+    if (!location.archetype || !location.archetype->getMask().test(componentId)) {
+        return;
+    }
+
+    move(index, getNeighbour(location.archetype, componentId, false));
+}
+
+template <typename T>
+T& ArchetypeStorage::get(Index index) const
+{
+    assert(index < locations.size());
+    const auto &location = locations[index];
+    assert(location.archetype);
+    return *static_cast<T*>(location.archetype->getComponent(Component<T>::getId(), location.chunk, location.row));
+}
+
+template <typename T>
+void ArchetypeStorage::accommodateComponent()
+{
+    auto &info = infos[Component<T>::getId()];
+
+    if (info.size == 0) {
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned components are not supported");
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        info.moveConstruct = [](void *destination, void *source) { new (destination) T(std::move(*static_cast<T*>(source))); };
+        info.destroy = [](void *object) { static_cast<T*>(object)->~T(); };
+    }
+}
+
+}
@@ -0,0 +1,45 @@
+#include "CommandBuffer.h"
+#include <cassert>
+
+namespace Mix
+{
+
+Entity CommandBuffer::createEntity(Entity *created)
+{
+    Entity placeholder((Entity::Id)createdOutputs.size());
+    placeholder.placeholder = true;
+    createdOutputs.push_back(created);
+    record(Type::Create, 0, placeholder, placeholder.getIndex());
+    return placeholder;
+}
+
+void CommandBuffer::kill(Entity e)
+{
+    record(Type::Kill, 0, e, 0);
+}
+
+void CommandBuffer::clear()
+{
+    commands.clear();
+    for (auto &store : stores) {
+        if (store) {
+            store->clear();
+        }
+    }
+    createdOutputs.clear();
+    sortKey = 0;
+}
+
+void CommandBuffer::record(Type type, BaseComponent::Id componentId, Entity e, uint32_t payload)
+{
+    // entities that belong to no world (e.g. default constructed ones) would be applied to a random entity at flush
+    assert((isBound(e) || isPlaceholder(e)) && "entity is neither a world's entity nor a placeholder");
+    commands.push_back({ sortKey, type, componentId, e, payload });
+}
+
+bool CommandBuffer::isPlaceholder(Entity e)
+{
+    return e.placeholder;
+}
+
+}
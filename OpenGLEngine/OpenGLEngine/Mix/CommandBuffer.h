@@ -0,0 +1,159 @@
+#pragma once
+
+#include "Entity.h"
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+namespace Mix
+{
+
+class World;
+
+/*
+    Records entity and component changes so they can be made later, when nothing else is touching the world.
+
+    Every thread gets its own buffer from World::getCommandBuffer(), so recording never takes a lock. The world flushes
+    all the buffers at the start of World::update(): commands are applied in sort key order, commands with the same
+    key in thread order and then in the order they were recorded. Commands recorded from a parallel loop should set
+    a sort key (e.g. the index of the item being processed) so the result doesn't depend on which thread ran what.
+
+    Example:
+
+    auto &commands = getWorld().getCommandBuffer();
+    auto e = commands.createEntity();
+    commands.addComponent<PositionComponent>(e, 1.0f, 2.0f);
+*/
+class CommandBuffer
+{
+public:
+    using SortKey = uint32_t;
+
+    CommandBuffer() {}
+
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+    /*
+        Creates an entity when the buffer is flushed. The returned entity is a placeholder that can only be used in
+        later commands of this buffer, if created is given the real entity is written there by the flush.
+    */
+    Entity createEntity(Entity *created = nullptr);
+
+    template <typename T> void addComponent(Entity e, T component);
+    template <typename T, typename ... Args> void addComponent(Entity e, Args && ... args);
+    template <typename T> void removeComponent(Entity e);
+    void kill(Entity e);
+
+    // key of the commands recorded from now on
+    void setSortKey(SortKey key) { sortKey = key; }
+
+    bool isEmpty() const { return commands.empty(); }
+    void clear();
+
+private:
+    enum class Type : uint8_t
+    {
+        Create,
+        AddComponent,
+        RemoveComponent,
+        Kill
+    };
+
+    struct Command
+    {
+        SortKey key;
+        Type type;
+        BaseComponent::Id componentId;
+        Entity entity;
+        uint32_t payload;           // slot in the component store, or the placeholder index for Create
+    };
+
+    // keeps the recorded components of one type
+    struct AbstractStore
+    {
+        virtual ~AbstractStore() {}
+        virtual void add(EntityManager &entityManager, Entity e, uint32_t slot) = 0;
+        virtual void remove(EntityManager &entityManager, Entity e) = 0;
+        virtual void clear() = 0;
+    };
+
+    template <typename T>
+    struct Store : AbstractStore
+    {
+        void add(EntityManager &entityManager, Entity e, uint32_t slot) override
+        {
+            entityManager.addComponent<T>(e, std::move(components[slot]));
+        }
+
+        void remove(EntityManager &entityManager, Entity e) override
+        {
+            entityManager.removeComponent<T>(e);
+        }
+
+        void clear() override
+        {
+            components.clear();
+        }
+
+        std::vector<T> components;
+    };
+
+    template <typename T>
+    Store<T>& accommodateStore();
+
+    void record(Type type, BaseComponent::Id componentId, Entity e, uint32_t payload);
+
+    // placeholders from createEntity() are tagged, a default constructed entity isn't one
+    static bool isPlaceholder(Entity e);
+
+    // true for entities that belong to a world
+    static bool isBound(Entity e) { return e.entityManager != nullptr; }
+
+    std::vector<Command> commands;
+    std::vector<std::unique_ptr<AbstractStore>> stores;     // index = component id
+    std::vector<Entity*> createdOutputs;                    // index = placeholder index
+    SortKey sortKey = 0;
+
+    friend class World;
+};
+
+template <typename T>
+void CommandBuffer::addComponent(Entity e, T component)
+{
+    auto &store = accommodateStore<T>();
+    store.components.push_back(std::move(component));
+    record(Type::AddComponent, Component<T>::getId(), e, (uint32_t)store.components.size() - 1);
+}
+
+template <typename T, typename ... Args>
+void CommandBuffer::addComponent(Entity e, Args && ... args)
+{
+    addComponent<T>(e, T(std::forward<Args>(args) ...));
+}
+
+template <typename T>
+void CommandBuffer::removeComponent(Entity e)
+{
+    accommodateStore<T>();
+    record(Type::RemoveComponent, Component<T>::getId(), e, 0);
+}
+
+template <typename T>
+CommandBuffer::Store<T>& CommandBuffer::accommodateStore()
+{
+    const auto componentId = Component<T>::getId();
+
+    if (componentId >= stores.size()) {
+        stores.resize(componentId + 1);
+    }
+
+    if (!stores[componentId]) {
+        stores[componentId].reset(new Store<T>());
+    }
+
+    return *static_cast<Store<T>*>(stores[componentId].get());
+}
+
+}
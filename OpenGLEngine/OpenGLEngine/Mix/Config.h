@@ -9,7 +9,17 @@ enum
     INDEX_BITS       = 24,
     VERSION_BITS     = 8,
     MINIMUM_FREE_IDS = 2048,
-    DEFAULT_POOL_SIZE = 1000
+    SPARSE_PAGE_SIZE = 4096,
+    ARCHETYPE_CHUNK_SIZE = 16384,
+    CACHE_LINE_SIZE  = 64,
+    DEFAULT_GRAIN_SIZE = 1024
+};
+
+// How an entity manager stores components.
+enum class Storage
+{
+    Sparse,     // one packed pool per component type
+    Archetype   // entities grouped by component mask into chunks, one column per component type
 };
 
 }
@@ -1,5 +1,6 @@
 #include "Entity.h"
 #include "World.h"
+#include <algorithm>
 #include <cassert>
 
 namespace Mix
@@ -15,22 +16,22 @@ bool Entity::isAlive() const
     return getEntityManager().isEntityAlive(*this);
 }
 
-void Entity::tag(std::string tag)
+void Entity::tag(Name tag)
 {
     getEntityManager().tagEntity(*this, tag);
 }
 
-bool Entity::hasTag(std::string tag) const
+bool Entity::hasTag(Name tag) const
 {
     return getEntityManager().hasTaggedEntity(tag, *this);
 }
 
-void Entity::group(std::string group)
+void Entity::group(Name group)
 {
     getEntityManager().groupEntity(*this, group);
 }
 
-bool Entity::hasGroup(std::string group) const
+bool Entity::hasGroup(Name group) const
 {
     return getEntityManager().hasEntityInGroup(group, *this);
 }
@@ -73,6 +74,34 @@ Entity EntityManager::createEntity()
     return e;
 }
 
+void EntityManager::createEntities(std::size_t count, std::vector<Entity> &entities)
+{
+    entities.reserve(entities.size() + count);
+
+    // reuse indices the same way createEntity() does, then append the rest in one go
+    while (count > 0 && freeIds.size() > MinimumFreeIds) {
+        const auto index = freeIds.front();
+        freeIds.pop_front();
+        entities.push_back(getEntity(index));
+        --count;
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    const auto first = (Entity::Id)versions.size();
+    assert(first + count <= (1u << Entity::IndexBits));
+    versions.resize(first + count, 0);
+    if (versions.size() > componentMasks.size()) {
+        componentMasks.resize(versions.size());
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        entities.push_back(getEntity(first + (Entity::Id)i));
+    }
+}
+
 void EntityManager::destroyEntity(Entity e)
 {
     const auto index = e.getIndex();
@@ -80,29 +109,26 @@ void EntityManager::destroyEntity(Entity e)
     assert(index < componentMasks.size());
     ++versions[index];                      // increase the version for that id
     freeIds.push_back(index);               // make the id available for reuse
-    componentMasks[index].reset();          // reset the component mask for that id
-
-    // if tagged, remove entity from tag management
-    auto taggedEntity = entityTags.find(e.id);
-    if (taggedEntity != entityTags.end()) {
-        auto tag = taggedEntity->second;
-        taggedEntities.erase(tag);
-        entityTags.erase(taggedEntity);
-    }
-
-    // if in group, remove entity from group management
-    auto groupedEntity = entityGroups.find(e.id);
-    if (groupedEntity != entityGroups.end()) {
-        auto groupName = groupedEntity->second;
-        auto group = groupedEntities.find(groupName);
-        if (group != groupedEntities.end()) {
-            auto entityInGroup = group->second.find(e);
-            if (entityInGroup != group->second.end()) {
-                group->second.erase(entityInGroup);
+
+    // drop the entity's components from their pools, then reset the component mask for that id
+    const auto &mask = componentMasks[index];
+    ++structureVersion;
+    markWritten(mask);
+    if (storage == Storage::Archetype) {
+        archetypes.destroy(index);
+    }
+    else {
+        for (std::size_t componentId = 0; componentId < componentPools.size(); ++componentId) {
+            if (mask.test(componentId)) {
+                componentPools[componentId]->remove(index);
             }
         }
-        entityGroups.erase(groupedEntity);
     }
+    componentMasks[index].reset();
+
+    // remove entity from tag and group management
+    untagEntity(e);
+    ungroupEntity(e);
 }
 
 void EntityManager::killEntity(Entity e)
@@ -117,14 +143,6 @@ bool EntityManager::isEntityAlive(Entity e) const
     return versions[index] == e.getVersion();
 }
 
-Entity EntityManager::getEntity(Entity::Id index)
-{
-    assert(index < versions.size());
-    Entity e(index, versions[index]);
-    e.entityManager = this;
-    return e;
-}
-
 const ComponentMask& EntityManager::getComponentMask(Entity e) const
 {
     const auto index = e.getIndex();
@@ -132,81 +150,158 @@ const ComponentMask& EntityManager::getComponentMask(Entity e) const
     return componentMasks[index];
 }
 
-void EntityManager::tagEntity(Entity e, std::string tag)
+void EntityManager::markWritten(const ComponentMask &mask)
 {
-    taggedEntities.emplace(tag, e);
-    entityTags.emplace(e.id, tag);
+    for (std::size_t componentId = 0; componentId < mask.size(); ++componentId) {
+        if (mask.test(componentId)) {
+            ++componentVersions[componentId];
+        }
+    }
 }
 
-bool EntityManager::hasTag(std::string tag) const
+void EntityManager::changeComponentMask(Entity e, const ComponentMask &previous)
 {
-    return taggedEntities.find(tag) != taggedEntities.end();
+    ++structureVersion;
+    world.changeEntity(e, previous);
 }
 
-bool EntityManager::hasTaggedEntity(std::string tag, Entity e) const
+void EntityManager::tagEntity(Entity e, Name tag)
 {
-    auto it = taggedEntities.find(tag);
-    if (it != taggedEntities.end()) {
-        if (it->second == e) {
-            return true;
-        }
+    if (hasTag(tag)) {
+        return;
+    }
+
+    untagEntity(e);
+    const auto name = tag.getId();
+    tags.insert(std::lower_bound(tags.begin(), tags.end(), name, [](const Tag &t, Name::Id n) { return t.name < n; }),
+        Tag{ name, e });
+
+    const auto index = e.getIndex();
+    if (index >= entityTags.size()) {
+        entityTags.resize(index + 1);
     }
-    return false;
+    entityTags[index] = name;
 }
 
-Entity EntityManager::getEntityByTag(std::string tag)
+bool EntityManager::hasTag(Name tag) const
 {
-    assert(hasTag(tag));
-    return taggedEntities[tag];
+    return findTag(tag.getId()) != tags.end();
 }
 
-int EntityManager::getTagCount() const
+bool EntityManager::hasTaggedEntity(Name tag, Entity e) const
 {
-    return taggedEntities.size();
+    auto it = findTag(tag.getId());
+    return it != tags.end() && it->entity == e;
 }
 
-void EntityManager::groupEntity(Entity e, std::string group)
+Entity EntityManager::getEntityByTag(Name tag) const
 {
-    groupedEntities.emplace(group, std::set<Entity>());
-    groupedEntities[group].emplace(e);
-    entityGroups.emplace(e.id, group);
+    auto it = findTag(tag.getId());
+    assert(it != tags.end());
+    return it->entity;
 }
 
-bool EntityManager::hasGroup(std::string group) const
+int EntityManager::getTagCount() const
 {
-    return groupedEntities.find(group) != groupedEntities.end();
+    return (int)tags.size();
 }
 
-bool EntityManager::hasEntityInGroup(std::string group, Entity e) const
+void EntityManager::groupEntity(Entity e, Name group)
 {
-    auto it = groupedEntities.find(group);
-    if (it != groupedEntities.end()) {
-        if (it->second.find(e.id) != it->second.end()) {
-            return true;
-        }
+    const auto name = group.getId();
+    const auto index = e.getIndex();
+    if (index < entityGroups.size() && entityGroups[index] == name) {
+        return;
+    }
+
+    ungroupEntity(e);
+
+    auto it = std::lower_bound(groups.begin(), groups.end(), name, [](const Group &g, Name::Id n) { return g.name < n; });
+    if (it == groups.end() || it->name != name) {
+        it = groups.insert(it, Group{ name, std::vector<Entity>() });
     }
-    return false;
+
+    auto &entities = it->entities;
+    entities.insert(std::lower_bound(entities.begin(), entities.end(), e), e);
+
+    if (index >= entityGroups.size()) {
+        entityGroups.resize(index + 1);
+    }
+    entityGroups[index] = name;
+}
+
+bool EntityManager::hasGroup(Name group) const
+{
+    return findGroup(group.getId()) != groups.end();
+}
+
+bool EntityManager::hasEntityInGroup(Name group, Entity e) const
+{
+    auto it = findGroup(group.getId());
+    return it != groups.end() && std::binary_search(it->entities.begin(), it->entities.end(), e);
 }
 
-std::vector<Entity> EntityManager::getEntityGroup(std::string group)
+Span<const Entity> EntityManager::getEntityGroup(Name group) const
 {
-    assert(hasGroup(group));
-    auto &s = groupedEntities[group];
-    return std::vector<Entity>(s.begin(), s.end());
+    auto it = findGroup(group.getId());
+    assert(it != groups.end());
+    return Span<const Entity>(it->entities.data(), it->entities.size());
 }
 
 int EntityManager::getGroupCount() const
 {
-    return groupedEntities.size();
+    return (int)groups.size();
+}
+
+int EntityManager::getEntityGroupCount(Name group) const
+{
+    auto it = findGroup(group.getId());
+    return it != groups.end() ? (int)it->entities.size() : 0;
 }
 
-int EntityManager::getEntityGroupCount(std::string group)
+std::vector<EntityManager::Tag>::const_iterator EntityManager::findTag(Name::Id name) const
 {
-    if (!hasGroup(group)) {
-        return 0;
+    auto it = std::lower_bound(tags.begin(), tags.end(), name, [](const Tag &t, Name::Id n) { return t.name < n; });
+    return it != tags.end() && it->name == name ? it : tags.end();
+}
+
+std::vector<EntityManager::Group>::const_iterator EntityManager::findGroup(Name::Id name) const
+{
+    auto it = std::lower_bound(groups.begin(), groups.end(), name, [](const Group &g, Name::Id n) { return g.name < n; });
+    return it != groups.end() && it->name == name ? it : groups.end();
+}
+
+void EntityManager::untagEntity(Entity e)
+{
+    const auto index = e.getIndex();
+    if (index >= entityTags.size() || entityTags[index] == NoName) {
+        return;
+    }
+
+    auto it = findTag(entityTags[index]);
+    if (it != tags.end()) {
+        tags.erase(it);
+    }
+    entityTags[index] = NoName;
+}
+
+void EntityManager::ungroupEntity(Entity e)
+{
+    const auto index = e.getIndex();
+    if (index >= entityGroups.size() || entityGroups[index] == NoName) {
+        return;
     }
 
-    return groupedEntities[group].size();
+    // empty groups are kept, hasGroup() is true for every group that ever had an entity
+    auto it = findGroup(entityGroups[index]);
+    if (it != groups.end()) {
+        auto &entities = groups[it - groups.begin()].entities;
+        auto entity = std::lower_bound(entities.begin(), entities.end(), e);
+        if (entity != entities.end() && *entity == e) {
+            entities.erase(entity);
+        }
+    }
+    entityGroups[index] = NoName;
 }
 
 }
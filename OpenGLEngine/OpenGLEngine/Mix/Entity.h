@@ -3,10 +3,11 @@
 #include "Config.h"
 #include "Component.h"
 #include "Pool.h"
+#include "Archetype.h"
+#include "Name.h"
+#include "Span.h"
 #include <vector>
 #include <deque>
-#include <unordered_map>
-#include <set>
 #include <memory>
 #include <string>
 #include <cstdint>
@@ -39,6 +40,12 @@ public:
     bool operator!=(const Entity &e) const { return getIndex() != e.getIndex(); }
     bool operator<(const Entity &e) const { return getIndex() < e.getIndex(); }
 
+    /*
+        The operators above compare indices only, and a dead entity's index comes back as another entity. Compares the
+        whole id, index and version, for handles kept from frame to frame.
+    */
+    bool isSame(const Entity &e) const { return id == e.id; }
+
     /*
         Returns the index part of the id.
     */
@@ -69,16 +76,16 @@ public:
     template <typename T> T& getComponent() const;
 
     /*
-        Tags the entity.
+        Tags the entity, an entity has at most one tag and tagging it again replaces the old one.
     */
-    void tag(std::string tag);
-    bool hasTag(std::string tag) const;
+    void tag(Name tag);
+    bool hasTag(Name tag) const;
 
     /*
-        Adds the entity to a certain group.
+        Adds the entity to a certain group, an entity is in at most one group and grouping it again moves it.
     */
-    void group(std::string group);
-    bool hasGroup(std::string group) const;
+    void group(Name group);
+    bool hasGroup(Name group) const;
 
     /*
         Returns a string of the entity (id + version).
@@ -96,20 +103,32 @@ private:
     // Id = index + version (kinda).
     Id id;
 
+    // set on the stand-ins CommandBuffer::createEntity() returns, sits in the padding between the id and the pointer
+    // on 64 bit
+    bool placeholder = false;
+
     EntityManager *entityManager = nullptr;
+
     friend class EntityManager;
+    friend class CommandBuffer;
 };
 
+static_assert(sizeof(void*) != 8 || sizeof(Entity) == 16, "the placeholder flag must not grow Entity");
+
 class EntityManager
 {
 public:
-    EntityManager(World &world) : world(world) {}
+    EntityManager(World &world, Storage storage = Storage::Sparse) : storage(storage), world(world) {}
 
     /*
         Entity management.
     */
     Entity createEntity();
     void destroyEntity(Entity e);
+
+    // creates count entities at once and appends them to entities, growing the bookkeeping vectors only once
+    void createEntities(std::size_t count, std::vector<Entity> &entities);
+
     void killEntity(Entity e);
     bool isEntityAlive(Entity e) const;
     Entity getEntity(Entity::Id index);
@@ -125,27 +144,60 @@ public:
     const ComponentMask& getComponentMask(Entity e) const;
 
     /*
-        Tag management.
+        Change counters, so code that copies component data can tell when its copy is stale.
+
+        The structure version changes whenever an entity gains or loses a component or is destroyed. References to
+        components stay valid while it doesn't. The version of a component type changes when one is added, replaced
+        or removed, and when a scheduled system that declares write access to the type has run. Code that writes
+        components any other way calls markWritten().
+    */
+    std::uint32_t getStructureVersion() const { return structureVersion; }
+    template <typename T> std::uint32_t getComponentVersion() const { return componentVersions[Component<T>::getId()]; }
+    template <typename T> void markWritten() { ++componentVersions[Component<T>::getId()]; }
+    void markWritten(const ComponentMask &mask);
+
+    /*
+        Storage access, used by views to iterate components directly.
     */
-    void tagEntity(Entity e, std::string tag);
-    bool hasTag(std::string tag) const;
-    bool hasTaggedEntity(std::string tag, Entity e) const;
-    Entity getEntityByTag(std::string tag);
+    Storage getStorage() const { return storage; }
+    const ArchetypeStorage& getArchetypeStorage() const { return archetypes; }
+
+    /*
+        Returns the packed pool of a component type (nullptr if no entity has had the component yet, or if the
+        manager uses archetype storage).
+    */
+    template <typename T> SparsePool<T>* getPool() const;
+
+    /*
+        Tag management. A tag that is already taken is not moved to another entity.
+    */
+    void tagEntity(Entity e, Name tag);
+    bool hasTag(Name tag) const;
+    bool hasTaggedEntity(Name tag, Entity e) const;
+    Entity getEntityByTag(Name tag) const;
     int getTagCount() const;
 
     /*
-        Group management.
+        Group management. The entities of a group are kept sorted by index, the span returned by getEntityGroup()
+        stays valid until an entity joins or leaves the group.
     */
-    void groupEntity(Entity e, std::string group);
-    bool hasGroup(std::string group) const;
-    bool hasEntityInGroup(std::string group, Entity e) const;
-    std::vector<Entity> getEntityGroup(std::string group);
+    void groupEntity(Entity e, Name group);
+    bool hasGroup(Name group) const;
+    bool hasEntityInGroup(Name group, Entity e) const;
+    Span<const Entity> getEntityGroup(Name group) const;
     int getGroupCount() const;
-    int getEntityGroupCount(std::string group);
+    int getEntityGroupCount(Name group) const;
 
 private:
     template <typename T>
-    std::shared_ptr<Pool<T>> accommodateComponent();
+    SparsePool<T>& accommodateComponent();
+
+    // lets the world move the entity to the systems that match its new components on the next update
+    void changeComponentMask(Entity e, const ComponentMask &previous);
+
+    std::uint32_t structureVersion = 0;
+    // index = component id
+    std::uint32_t componentVersions[BaseComponent::MaxComponents] = {};
 
     // minimum amount of free indices before we reuse one
     const std::uint32_t MinimumFreeIds = MINIMUM_FREE_IDS;
@@ -157,24 +209,55 @@ private:
     std::vector<Entity::Version> versions;
 
     // vector of component pools, each pool contains all the data for a certain component type
-    // vector index = component id, pool index = entity id
-    std::vector<std::shared_ptr<AbstractPool>> componentPools;
+    // vector index = component id, the pool maps entity ids to its packed component data
+    std::vector<std::unique_ptr<SparseSet>> componentPools;
+
+    // used instead of the component pools when storage is Storage::Archetype
+    ArchetypeStorage archetypes;
+    const Storage storage;
 
     // vector of component masks, each mask lets us know which components are turned "on" for a specific entity
     // vector index = entity id, each bit set to 1 means that the entity has that component
     std::vector<ComponentMask> componentMasks;
 
-    // maps a tag to an entity
-    std::unordered_map<std::string, Entity> taggedEntities;
-    std::unordered_map<Entity::Id, std::string> entityTags;
+    struct Tag
+    {
+        Name::Id name;
+        Entity entity;
+    };
+
+    struct Group
+    {
+        Name::Id name;
+        std::vector<Entity> entities;   // sorted by index
+    };
+
+    std::vector<Tag>::const_iterator findTag(Name::Id name) const;
+    std::vector<Group>::const_iterator findGroup(Name::Id name) const;
+
+    void untagEntity(Entity e);
+    void ungroupEntity(Entity e);
 
-    // maps a tag to a group of entities
-    std::unordered_map<std::string, std::set<Entity>> groupedEntities;
-    std::unordered_map<Entity::Id, std::string> entityGroups;
+    // tags and groups sorted by name, so lookups are a binary search over flat memory
+    std::vector<Tag> tags;
+    std::vector<Group> groups;
+
+    // name of the tag and the group of each entity, index = entity index, NoName if it has none
+    static const Name::Id NoName = 0;
+    std::vector<Name::Id> entityTags;
+    std::vector<Name::Id> entityGroups;
 
     World &world;
 };
 
+inline Entity EntityManager::getEntity(Entity::Id index)
+{
+    assert(index < versions.size());
+    Entity e(index, versions[index]);
+    e.entityManager = this;
+    return e;
+}
+
 template <typename T>
 void Entity::addComponent(T component)
 {
@@ -210,14 +293,21 @@ void EntityManager::addComponent(Entity e, T component)
 {
     const auto componentId = Component<T>::getId();
     const auto entityId = e.getIndex();
-    std::shared_ptr<Pool<T>> componentPool = accommodateComponent<T>();
+    assert(entityId < componentMasks.size());
 
-    if (entityId >= componentPool->getSize()) {
-        componentPool->resize(versions.size());
+    if (storage == Storage::Archetype) {
+        archetypes.set<T>(entityId, component);
+    }
+    else {
+        accommodateComponent<T>().set(entityId, component);
     }
 
-    componentPool->set(entityId, component);
-    componentMasks[entityId].set(componentId);
+    ++componentVersions[componentId];
+    if (!componentMasks[entityId].test(componentId)) {
+        const auto previous = componentMasks[entityId];
+        componentMasks[entityId].set(componentId);
+        changeComponentMask(e, previous);
+    }
 }
 
 template <typename T, typename ... Args>
@@ -233,7 +323,22 @@ void EntityManager::removeComponent(Entity e)
     const auto componentId = Component<T>::getId();
     const auto entityId = e.getIndex();
     assert(entityId < componentMasks.size());
+
+    if (!componentMasks[entityId].test(componentId)) {
+        return;
+    }
+
+    if (storage == Storage::Archetype) {
+        archetypes.remove<T>(entityId);
+    }
+    else {
+        componentPools[componentId]->remove(entityId);
+    }
+
+    ++componentVersions[componentId];
+    const auto previous = componentMasks[entityId];
     componentMasks[entityId].set(componentId, false);
+    changeComponentMask(e, previous);
 }
 
 template <typename T>
@@ -252,29 +357,44 @@ T& EntityManager::getComponent(Entity e) const
     const auto entityId = e.getIndex();
 
     assert(hasComponent<T>(e));
+
+    if (storage == Storage::Archetype) {
+        return archetypes.get<T>(entityId);
+    }
+
     assert(componentId < componentPools.size());
-    auto componentPool = std::static_pointer_cast<Pool<T>>(componentPools[componentId]);
+    auto componentPool = static_cast<SparsePool<T>*>(componentPools[componentId].get());
 
     assert(componentPool);
-    assert(entityId < componentPool->getSize());
     return componentPool->get(entityId);
 }
 
 template <typename T>
-std::shared_ptr<Pool<T>> EntityManager::accommodateComponent()
+SparsePool<T>* EntityManager::getPool() const
+{
+    const auto componentId = Component<T>::getId();
+
+    if (storage == Storage::Archetype || componentId >= componentPools.size()) {
+        return nullptr;
+    }
+
+    return static_cast<SparsePool<T>*>(componentPools[componentId].get());
+}
+
+template <typename T>
+SparsePool<T>& EntityManager::accommodateComponent()
 {
     const auto componentId = Component<T>::getId();
 
     if (componentId >= componentPools.size()) {
-        componentPools.resize(componentId + 1, nullptr);
+        componentPools.resize(componentId + 1);
     }
 
     if (!componentPools[componentId]) {
-        std::shared_ptr<Pool<T>> pool(new Pool<T>());
-        componentPools[componentId] = pool;
+        componentPools[componentId].reset(new SparsePool<T>());
     }
 
-    return std::static_pointer_cast<Pool<T>>(componentPools[componentId]);
+    return *static_cast<SparsePool<T>*>(componentPools[componentId].get());
 }
 
 }
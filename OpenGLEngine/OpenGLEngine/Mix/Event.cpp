@@ -8,10 +8,8 @@ BaseEvent::Id BaseEvent::nextId = 0;
 
 void EventManager::destroyEvents()
 {
-    for (auto &it : eventPools) {
-        auto pool = it.second;
-        pool->clear();
-    }
+    // every channel sees the new frame the next time it's used and starts over
+    ++frame;
 }
 
 }
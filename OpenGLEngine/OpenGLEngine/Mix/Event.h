@@ -1,10 +1,9 @@
 #pragma once
 
-#include "Pool.h"
-#include <unordered_map>
+#include "Span.h"
 #include <vector>
 #include <memory>
-#include <typeindex>
+#include <utility>
 #include <cstdint>
 
 namespace Mix
@@ -30,6 +29,56 @@ struct Event : BaseEvent
     }
 };
 
+// Required to have a vector of channels containing different event types.
+class AbstractEventChannel
+{
+public:
+    virtual ~AbstractEventChannel() {}
+};
+
+/*
+    The events of one type that were emitted during the current frame.
+
+    The storage is kept from frame to frame and overwritten, a channel is cleared by moving the event manager on to
+    the next frame, so neither emitting nor clearing allocates once the channel has grown to the usual event count.
+*/
+template <typename T>
+class EventChannel : public AbstractEventChannel
+{
+public:
+    void emit(T event, uint32_t frame)
+    {
+        use(frame);
+        if (count < events.size()) {
+            events[count] = std::move(event);
+        }
+        else {
+            events.push_back(std::move(event));
+        }
+        ++count;
+    }
+
+    Span<const T> getEvents(uint32_t frame)
+    {
+        use(frame);
+        return Span<const T>(events.data(), count);
+    }
+
+private:
+    // events left over from an earlier frame don't count
+    void use(uint32_t frame)
+    {
+        if (this->frame != frame) {
+            this->frame = frame;
+            count = 0;
+        }
+    }
+
+    std::vector<T> events;
+    std::size_t count = 0;
+    uint32_t frame = 0;
+};
+
 class EventManager
 {
 public:
@@ -41,16 +90,19 @@ public:
     template <typename T, typename ... Args>
     void emitEvent(Args && ... args);
 
+    // the events emitted since the last destroyEvents(), valid until the next emitEvent<T>() or destroyEvents()
     template <typename T>
-    std::vector<T> getEvents();
+    Span<const T> getEvents();
 
     void destroyEvents();
 
 private:
     template <typename T>
-    std::shared_ptr<Pool<T>> accommodateEvent();
+    EventChannel<T>& accommodateEvent();
 
-    std::unordered_map<std::type_index, std::shared_ptr<AbstractPool>> eventPools;
+    // index = event id
+    std::vector<std::unique_ptr<AbstractEventChannel>> channels;
+    uint32_t frame = 0;
 
     World &world;
 };
@@ -58,32 +110,35 @@ private:
 template <typename T>
 void EventManager::emitEvent(T event)
 {
-    std::shared_ptr<Pool<T>> eventPool = accommodateEvent<T>();
-    eventPool->add(event);
+    accommodateEvent<T>().emit(std::move(event), frame);
 }
 
 template <typename T, typename ... Args>
 void EventManager::emitEvent(Args && ... args)
 {
-    T event(std::forward<Args>(args) ...);
-    emitEvent<T>(event);
+    emitEvent<T>(T(std::forward<Args>(args) ...));
 }
 
 template <typename T>
-std::shared_ptr<Pool<T>> EventManager::accommodateEvent()
+Span<const T> EventManager::getEvents()
 {
-    if (eventPools.find(std::type_index(typeid(T))) == eventPools.end()) {
-        std::shared_ptr<Pool<T>> pool(new Pool<T>());
-        eventPools.insert(std::make_pair(std::type_index(typeid(T)), pool));
-    }
-
-    return std::static_pointer_cast<Pool<T>>(eventPools[std::type_index(typeid(T))]);
+    return accommodateEvent<T>().getEvents(frame);
 }
 
 template <typename T>
-std::vector<T> EventManager::getEvents()
+EventChannel<T>& EventManager::accommodateEvent()
 {
-    return std::static_pointer_cast<Pool<T>>(eventPools[std::type_index(typeid(T))])->getData();
+    const auto eventId = Event<T>::getId();
+
+    if (eventId >= channels.size()) {
+        channels.resize(eventId + 1);
+    }
+
+    if (!channels[eventId]) {
+        channels[eventId].reset(new EventChannel<T>());
+    }
+
+    return *static_cast<EventChannel<T>*>(channels[eventId].get());
 }
 
 }
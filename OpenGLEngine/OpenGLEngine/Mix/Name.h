@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace Mix
+{
+
+/*
+    A tag or group name interned as a 64-bit FNV-1a hash of the string, so comparing and looking up names never
+    touches the string again.
+
+    A name made from a string literal in a constexpr context is hashed at compile time:
+
+    constexpr Mix::Name Player("player");
+    e.tag(Player);
+    auto player = world.getEntity(Player);
+
+    Passing a literal or a std::string directly still works, it just hashes the string at the call site.
+*/
+class Name
+{
+public:
+    using Id = uint64_t;
+
+    constexpr Name(const char *string) : id(hash(string)) {}
+    Name(const std::string &string) : id(hash(string.c_str())) {}
+
+    constexpr Id getId() const { return id; }
+
+    constexpr bool operator==(const Name &other) const { return id == other.id; }
+    constexpr bool operator!=(const Name &other) const { return id != other.id; }
+    constexpr bool operator<(const Name &other) const { return id < other.id; }
+
+private:
+    static constexpr Id hash(const char *string)
+    {
+        Id result = 14695981039346656037ull;
+        while (*string) {
+            result = (result ^ (unsigned char)*string++) * 1099511628211ull;
+        }
+        return result;
+    }
+
+    Id id;
+};
+
+}
@@ -2,6 +2,10 @@
 
 #include "Config.h"
 #include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
 #include <cassert>
 
 namespace Mix
@@ -15,69 +19,166 @@ public:
     virtual void clear() = 0;
 };
 
-// A pool is just a vector (contiguous data) of objects of type T.
-template <typename T>
-class Pool : public AbstractPool
+/*
+    A sparse set maps entity indices to slots in a packed array.
+
+    The packed side only holds the indices that are actually in the set, so iterating it never touches dead entities.
+    The sparse side is split into pages that are allocated on first use, so its memory follows the indices in use
+    rather than every index ever handed out by the entity manager.
+*/
+class SparseSet : public AbstractPool
 {
 public:
-    Pool(int size = DEFAULT_POOL_SIZE)
+    using Index = uint32_t;
+
+    enum : Index
     {
-        resize(size);
-    }
+        InvalidSlot = ~Index(0),
+        PageSize    = SPARSE_PAGE_SIZE
+    };
 
-    virtual ~Pool() {}
+    virtual ~SparseSet() {}
 
     bool isEmpty() const
     {
-        return data.empty();
+        return packed.empty();
     }
 
     unsigned int getSize() const
     {
-        return data.size();
+        return (unsigned int)packed.size();
     }
 
-    void resize(int n)
+    bool contains(Index index) const
     {
-        data.resize(n);
+        return getSlot(index) != InvalidSlot;
     }
 
-    void clear()
+    // returns the slot of an index in the packed array (or InvalidSlot)
+    Index getSlot(Index index) const
     {
-        data.clear();
+        const auto page = index / PageSize;
+        if (page >= sparse.size() || !sparse[page]) {
+            return InvalidSlot;
+        }
+        return sparse[page][index % PageSize];
+    }
+
+    // packed array of indices, slot i holds the index whose data lives in slot i
+    const std::vector<Index>& getIndices() const
+    {
+        return packed;
     }
 
-    bool set(unsigned int index, T object)
+    // swap-and-pop, the last index takes the slot of the removed one
+    virtual void remove(Index index)
     {
-        assert(index < getSize());
-        data[index] = object;
-        return true;
+        const auto slot = getSlot(index);
+        assert(slot != InvalidSlot);
+        const auto last = packed.back();
+        packed[slot] = last;
+        setSlot(last, slot);
+        setSlot(index, InvalidSlot);
+        packed.pop_back();
     }
 
-    T& get(unsigned int index)
+    virtual void clear()
     {
-        assert(index < getSize());
-        return static_cast<T&>(data[index]);
+        for (auto index : packed) {
+            setSlot(index, InvalidSlot);
+        }
+        packed.clear();
     }
 
-    void add(T object)
+protected:
+    Index insert(Index index)
     {
-        data.push_back(object);
+        assert(!contains(index));
+        const auto slot = (Index)packed.size();
+        packed.push_back(index);
+        setSlot(index, slot);
+        return slot;
     }
 
-    T& operator[](unsigned int index)
+private:
+    void setSlot(Index index, Index slot)
     {
-        return data[index];
+        const auto page = index / PageSize;
+        if (page >= sparse.size()) {
+            sparse.resize(page + 1);
+        }
+        if (!sparse[page]) {
+            sparse[page].reset(new Index[PageSize]);
+            std::fill(sparse[page].get(), sparse[page].get() + PageSize, (Index)InvalidSlot);
+        }
+        sparse[page][index % PageSize] = slot;
     }
 
-    const T& operator[](unsigned int index) const
+    std::vector<std::unique_ptr<Index[]>> sparse;
+    std::vector<Index> packed;
+};
+
+// A sparse pool keeps objects of type T packed next to each other, in the same order as the set's indices.
+template <typename T>
+class SparsePool : public SparseSet
+{
+public:
+    virtual ~SparsePool() {}
+
+    // adds the object for an index, or overwrites it if the index already has one
+    T& set(Index index, T object)
     {
-        return data[index];
+        const auto slot = getSlot(index);
+        if (slot != InvalidSlot) {
+            data[slot] = std::move(object);
+            return data[slot];
+        }
+
+        insert(index);
+        data.push_back(std::move(object));
+        return data.back();
     }
 
-    std::vector<T> getData()
+    T& get(Index index)
     {
-        return data;
+        const auto slot = getSlot(index);
+        assert(slot != InvalidSlot);
+        return data[slot];
+    }
+
+    const T& get(Index index) const
+    {
+        const auto slot = getSlot(index);
+        assert(slot != InvalidSlot);
+        return data[slot];
+    }
+
+    // packed objects, getData()[i] belongs to getIndices()[i]
+    T* getData()
+    {
+        return data.data();
+    }
+
+    const T* getData() const
+    {
+        return data.data();
+    }
+
+    void remove(Index index) override
+    {
+        const auto slot = getSlot(index);
+        assert(slot != InvalidSlot);
+        if (slot != data.size() - 1) {
+            data[slot] = std::move(data.back());
+        }
+        data.pop_back();
+        SparseSet::remove(index);
+    }
+
+    void clear() override
+    {
+        data.clear();
+        SparseSet::clear();
     }
 
 private:
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cassert>
+
+namespace Mix
+{
+
+// A non-owning view of contiguous objects, it stays valid as long as the storage it points into isn't changed.
+template <typename T>
+class Span
+{
+public:
+    Span() {}
+    Span(T *first, std::size_t size) : first(first), last(first + size) {}
+
+    T* begin() const { return first; }
+    T* end() const { return last; }
+    T* data() const { return first; }
+
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+
+    T& operator[](std::size_t index) const
+    {
+        assert(index < size());
+        return first[index];
+    }
+
+private:
+    T *first = nullptr;
+    T *last = nullptr;
+};
+
+}
@@ -1,20 +1,48 @@
 #include "System.h"
 #include "World.h"
 #include <algorithm>
+#include <thread>
 
 namespace Mix
 {
 
 void System::addEntity(Entity e)
 {
-    entities.push_back(e);
+    if (!hasEntity(e)) {
+        entities.set(e.getIndex(), e);
+    }
 }
 
 void System::removeEntity(Entity e)
 {
-    entities.erase(std::remove_if(entities.begin(), entities.end(),
-        [&e](Entity other) { return e == other; }
-    ), entities.end());
+    if (hasEntity(e)) {
+        entities.remove(e.getIndex());
+    }
+}
+
+void System::requireMainThread()
+{
+    mainThread = true;
+    accessDeclared = true;
+}
+
+void System::requireExclusiveAccess()
+{
+    exclusive = true;
+    accessDeclared = true;
+}
+
+bool System::conflictsWith(const System &other) const
+{
+    if (isExclusive() || other.isExclusive()) {
+        return true;
+    }
+
+    if (runsOnMainThread() && other.runsOnMainThread()) {
+        return true;
+    }
+
+    return (writeMask & (other.readMask | other.writeMask)).any() || (other.writeMask & readMask).any();
 }
 
 World& System::getWorld() const
@@ -23,27 +51,226 @@ World& System::getWorld() const
     return *world;
 }
 
+ThreadPool& System::getThreadPool() const
+{
+    return getWorld().getSystemManager().getThreadPool();
+}
+
 void SystemManager::addToSystems(Entity e)
 {
-    const auto &entityComponentMask = world.getEntityManager().getComponentMask(e);
+    const auto &mask = world.getEntityManager().getComponentMask(e);
 
-    for (auto &it : systems) {
-        auto &system = it.second;
-        const auto &systemComponentMask = system->getComponentMask();
-        auto interest = (entityComponentMask & systemComponentMask) == systemComponentMask;
+    for (auto system : getMatchingSystems(mask)) {
+        system->addEntity(e);
+    }
+    setRoutedMask(e, mask);
+}
+
+void SystemManager::removeFromSystems(Entity e)
+{
+    for (auto system : getMatchingSystems(getRoutedMask(e))) {
+        system->removeEntity(e);
+    }
+    setRoutedMask(e, ComponentMask());
+}
 
-        if (interest) {
+void SystemManager::addToSystems(const std::vector<Entity> &added)
+{
+    const auto &entityManager = world.getEntityManager();
+
+    // entities are usually created in runs with the same components, so only look up the systems when the mask changes
+    ComponentMask mask;
+    const std::vector<System*> *matches = &getMatchingSystems(mask);
+
+    for (auto e : added) {
+        const auto &entityComponentMask = entityManager.getComponentMask(e);
+        if (entityComponentMask != mask) {
+            mask = entityComponentMask;
+            matches = &getMatchingSystems(mask);
+        }
+
+        for (auto system : *matches) {
             system->addEntity(e);
         }
+        setRoutedMask(e, mask);
     }
 }
 
-void SystemManager::removeFromSystems(Entity e)
+void SystemManager::removeFromSystems(const std::vector<Entity> &removed)
+{
+    for (auto e : removed) {
+        removeFromSystems(e);
+    }
+}
+
+void SystemManager::updateSystems(const std::vector<Entity> &changed)
+{
+    const auto &entityManager = world.getEntityManager();
+
+    for (auto e : changed) {
+        if (!entityManager.isEntityAlive(e)) {
+            continue;
+        }
+
+        const auto &mask = entityManager.getComponentMask(e);
+        const auto &routedMask = getRoutedMask(e);
+        if (mask == routedMask) {
+            continue;
+        }
+
+        for (auto system : getMatchingSystems(routedMask)) {
+            const auto &systemComponentMask = system->getComponentMask();
+            if ((mask & systemComponentMask) != systemComponentMask) {
+                system->removeEntity(e);
+            }
+        }
+
+        for (auto system : getMatchingSystems(mask)) {
+            system->addEntity(e);
+        }
+        setRoutedMask(e, mask);
+    }
+}
+
+const ComponentMask& SystemManager::getRoutedMask(Entity e) const
+{
+    static const ComponentMask none;
+    const auto index = e.getIndex();
+    return index < routedMasks.size() ? routedMasks[index] : none;
+}
+
+void SystemManager::setRoutedMask(Entity e, const ComponentMask &mask)
 {
+    const auto index = e.getIndex();
+    if (index >= routedMasks.size()) {
+        if (mask.none()) {
+            return;
+        }
+        routedMasks.resize(index + 1);
+    }
+    routedMasks[index] = mask;
+}
+
+const std::vector<System*>& SystemManager::getMatchingSystems(const ComponentMask &mask)
+{
+    auto cached = matchingSystems.find(mask);
+    if (cached != matchingSystems.end()) {
+        return cached->second;
+    }
+
+    std::vector<System*> matches;
     for (auto &it : systems) {
-        auto &system = it.second;
-        system->removeEntity(e);
+        const auto &systemComponentMask = it.second->getComponentMask();
+        if ((mask & systemComponentMask) == systemComponentMask) {
+            matches.push_back(it.second.get());
+        }
+    }
+
+    return matchingSystems.emplace(mask, std::move(matches)).first->second;
+}
+
+void SystemManager::schedule(System &system, std::function<void()> task)
+{
+    ScheduledTask scheduledTask;
+    scheduledTask.system = &system;
+    scheduledTask.run = std::move(task);
+    scheduled.push_back(std::move(scheduledTask));
+}
+
+void SystemManager::runScheduled()
+{
+    const auto count = (unsigned int)scheduled.size();
+    if (count == 0) {
+        return;
+    }
+
+    // every task waits for the earlier tasks it conflicts with
+    for (unsigned int i = 0; i < count; ++i) {
+        for (unsigned int j = 0; j < i; ++j) {
+            if (scheduled[j].system->conflictsWith(*scheduled[i].system)) {
+                scheduled[j].dependents.push_back(i);
+                ++scheduled[i].dependencyCount;
+            }
+        }
+    }
+
+    waitingFor.reset(new std::atomic<int>[count]);
+    for (unsigned int i = 0; i < count; ++i) {
+        waitingFor[i] = scheduled[i].dependencyCount;
+    }
+    unfinished = count;
+
+    auto &pool = getThreadPool();
+    for (unsigned int i = 0; i < count; ++i) {
+        if (scheduled[i].dependencyCount == 0) {
+            release(i);
+        }
+    }
+
+    // run the main thread tasks as they become ready and help the workers in between
+    while (unfinished > 0) {
+        unsigned int task = count;
+        {
+            std::lock_guard<std::mutex> lock(mainThreadMutex);
+            if (!mainThreadTasks.empty()) {
+                task = mainThreadTasks.back();
+                mainThreadTasks.pop_back();
+            }
+        }
+
+        if (task != count) {
+            execute(task);
+        }
+        else if (!pool.runPending()) {
+            std::this_thread::yield();
+        }
+    }
+
+    scheduled.clear();
+}
+
+ThreadPool& SystemManager::getThreadPool()
+{
+    if (!threadPool) {
+        threadPool = std::make_unique<ThreadPool>();
+        world.accommodateCommandBuffers(threadPool->getThreadCount() + 1);
+    }
+    return *threadPool;
+}
+
+void SystemManager::setThreadCount(unsigned int threadCount)
+{
+    threadPool.reset();
+    threadPool = std::make_unique<ThreadPool>(threadCount);
+    world.accommodateCommandBuffers(threadCount + 1);
+}
+
+void SystemManager::release(unsigned int task)
+{
+    if (scheduled[task].system->runsOnMainThread()) {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        mainThreadTasks.push_back(task);
     }
+    else {
+        getThreadPool().submit([this, task]() { execute(task); });
+    }
+}
+
+void SystemManager::execute(unsigned int task)
+{
+    scheduled[task].run();
+
+    // systems that never declared their access could have written anything
+    const auto &system = *scheduled[task].system;
+    world.getEntityManager().markWritten(system.accessDeclared ? system.writeMask : ComponentMask().set());
+
+    for (auto dependent : scheduled[task].dependents) {
+        if (--waitingFor[dependent] == 0) {
+            release(dependent);
+        }
+    }
+
+    --unfinished;
 }
 
 }
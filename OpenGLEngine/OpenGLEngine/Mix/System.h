@@ -2,16 +2,23 @@
 
 #include "Event.h"
 #include "Entity.h"
+#include "ThreadPool.h"
+#include "Span.h"
 #include <vector>
 #include <unordered_map>
 #include <typeindex>
 #include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
 
 namespace Mix
 {
 
 class SystemManager;
 class World;
+template <typename ... Ts>
+class View;
 
 // The system processes entities that it's interested in each frame. Derive from this one!
 class System
@@ -23,26 +30,80 @@ public:
     template <typename T>
     void requireComponent();
 
+    /*
+        What the system touches when it runs, so the scheduler knows which systems can run at the same time.
+        Required components count as read access. Systems that never declare their access are treated as exclusive.
+    */
+
+    // the system reads components of type T
+    template <typename T>
+    void requireReadAccess();
+
+    // the system writes components of type T
+    template <typename T>
+    void requireWriteAccess();
+
+    // the system has to run on the thread that runs the schedule (GL calls, input, the camera)
+    void requireMainThread();
+
+    // the system changes the world itself (creates/kills entities, adds/removes components), nothing runs next to it.
+    // it still declares the components it writes, their versions change after it runs (see EntityManager)
+    void requireExclusiveAccess();
+
     // returns a list of entities that the system should process each frame
-    std::vector<Entity> getEntities() { return entities; }
+    Span<const Entity> getEntities() const { return Span<const Entity>(entities.getData(), entities.getSize()); }
+
+    /*
+        Calls fn(Entity) for every entity of the system, split into ranges of grainSize entities (rounded up to whole
+        cache lines) that run on the thread pool. Runs serially when there are no more than grainSize entities.
+        fn must only touch the entity's own components, and must not create/kill entities or add/remove components.
+    */
+    template <typename Fn>
+    void parallelForEach(unsigned int grainSize, Fn fn);
+
+    /*
+        Returns a view over the system's entities that have the components Ts, iterated straight over the packed pools
+        like World::view(). Unlike that one it skips entities the system doesn't have (yet), e.g. ones created this
+        frame before World::update() registered them.
+    */
+    template <typename ... Ts>
+    View<Ts...> view() const;
 
-    // adds an entity of interest
+    // adds an entity of interest (does nothing if the system already has it)
     void addEntity(Entity e);
 
-    // if the entity is not alive anymore (during processing), the entity should be removed
+    // if the entity is not alive anymore (during processing), the entity should be removed.
+    // the last entity takes the removed entity's place, so this doesn't keep the order of the entities.
     void removeEntity(Entity e);
 
+    bool hasEntity(Entity e) const { return entities.contains(e.getIndex()); }
+
     const ComponentMask& getComponentMask() const { return componentMask; }
 
+    bool isExclusive() const { return exclusive || !accessDeclared; }
+    bool runsOnMainThread() const { return mainThread || isExclusive(); }
+
+    // true if the two systems must not run at the same time
+    bool conflictsWith(const System &other) const;
+
 protected:
     World& getWorld() const;
+    ThreadPool& getThreadPool() const;
 
 private:
     // which components an entity must have in order for the system to process the entity
     ComponentMask componentMask;
 
-    // vector of all entities that the system is interested in
-    std::vector<Entity> entities;
+    // all entities that the system is interested in, packed and indexed by entity index
+    SparsePool<Entity> entities;
+
+    // components the system reads and writes
+    ComponentMask readMask;
+    ComponentMask writeMask;
+
+    bool accessDeclared = false;
+    bool mainThread = false;
+    bool exclusive = false;
 
     World *world = nullptr;
     friend class SystemManager;
@@ -51,7 +112,7 @@ private:
 class SystemManager
 {
 public:
-    SystemManager(World &world) : world(world) {}
+    SystemManager(World &world) : unfinished(0), world(world) {}
 
     template <typename T>
     void addSystem();
@@ -74,8 +135,69 @@ public:
     // removes an entity from interested systems' entity lists
     void removeFromSystems(Entity e);
 
+    // the same for many entities at once
+    void addToSystems(const std::vector<Entity> &added);
+    void removeFromSystems(const std::vector<Entity> &removed);
+
+    // moves entities whose components changed after they were added into the systems that match them now
+    void updateSystems(const std::vector<Entity> &changed);
+
+    // the component mask the entity had when it was last added to or moved between the systems
+    const ComponentMask& getRoutedMask(Entity e) const;
+
+    // queues a call to T::Update(deltaTime) for the next runScheduled()
+    template <typename T>
+    void schedule(float deltaTime);
+
+    // queues a task that touches the same data as the system
+    void schedule(System &system, std::function<void()> task);
+
+    /*
+        Runs the queued tasks and empties the queue.
+
+        Two tasks depend on each other if one writes a component type the other reads or writes, if both have to run
+        on the main thread, or if one of them is exclusive. The later task then waits for the earlier one, so the
+        result is the same as calling the tasks one after another in the order they were queued. Everything else
+        runs at the same time on the thread pool, main thread tasks run on the calling thread.
+    */
+    void runScheduled();
+
+    // started on first use with ThreadPool::getDefaultThreadCount() workers
+    ThreadPool& getThreadPool();
+
+    // restarts the thread pool with a number of workers, don't call it while the schedule is running
+    void setThreadCount(unsigned int threadCount);
+
 private:
+    struct ScheduledTask
+    {
+        System *system;
+        std::function<void()> run;
+        std::vector<unsigned int> dependents;
+        int dependencyCount = 0;
+    };
+
+    // hands a task whose dependencies are done to the thread pool or to the main thread
+    void release(unsigned int task);
+    void execute(unsigned int task);
+
+    // systems interested in entities with the mask, looked up once per mask and cached until the systems change
+    const std::vector<System*>& getMatchingSystems(const ComponentMask &mask);
+
+    void setRoutedMask(Entity e, const ComponentMask &mask);
+
     std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
+    std::unordered_map<ComponentMask, std::vector<System*>> matchingSystems;
+
+    // index = entity index
+    std::vector<ComponentMask> routedMasks;
+
+    std::vector<ScheduledTask> scheduled;
+    std::unique_ptr<std::atomic<int>[]> waitingFor;
+    std::atomic<unsigned int> unfinished;
+    std::mutex mainThreadMutex;
+    std::vector<unsigned int> mainThreadTasks;
+    std::unique_ptr<ThreadPool> threadPool;
 
     World &world;
 };
@@ -85,6 +207,33 @@ void System::requireComponent()
 {
     const auto componentId = Component<T>::getId();
     componentMask.set(componentId);
+    readMask.set(componentId);
+}
+
+template <typename Fn>
+void System::parallelForEach(unsigned int grainSize, Fn fn)
+{
+    const auto systemEntities = getEntities();
+    getThreadPool().parallelFor((unsigned int)systemEntities.size(), ThreadPool::alignToCacheLines(grainSize),
+        [&systemEntities, &fn](unsigned int begin, unsigned int end) {
+            for (auto i = begin; i < end; ++i) {
+                fn(systemEntities[i]);
+            }
+        });
+}
+
+template <typename T>
+void System::requireReadAccess()
+{
+    readMask.set(Component<T>::getId());
+    accessDeclared = true;
+}
+
+template <typename T>
+void System::requireWriteAccess()
+{
+    writeMask.set(Component<T>::getId());
+    accessDeclared = true;
 }
 
 template <typename T>
@@ -97,6 +246,7 @@ void SystemManager::addSystem()
     std::shared_ptr<T> system(new T);
     system->world = &world;
     systems.insert(std::make_pair(std::type_index(typeid(T)), system));
+    matchingSystems.clear();
 }
 
 template <typename T, typename ... Args>
@@ -109,6 +259,7 @@ void SystemManager::addSystem(Args && ... args)
     std::shared_ptr<T> system(new T(std::forward<Args>(args) ...));
     system->world = &world;
     systems.insert(std::make_pair(std::type_index(typeid(T)), system));
+    matchingSystems.clear();
 }
 
 template <typename T>
@@ -120,6 +271,7 @@ void SystemManager::removeSystem()
 
     auto it = systems.find(std::type_index(typeid(T)));
     systems.erase(it);
+    matchingSystems.clear();
 }
 
 template <typename T>
@@ -133,6 +285,13 @@ T& SystemManager::getSystem()
     return *(std::static_pointer_cast<T>(it->second));
 }
 
+template <typename T>
+void SystemManager::schedule(float deltaTime)
+{
+    auto &system = getSystem<T>();
+    schedule(system, [&system, deltaTime]() { system.Update(deltaTime); });
+}
+
 template <typename T>
 bool SystemManager::hasSystem() const
 {
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+
+namespace Mix
+{
+
+namespace
+{
+
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local unsigned int currentIndex = 0;
+
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) : pending(0)
+{
+    for (unsigned int i = 0; i <= threadCount; ++i) {
+        queues.emplace_back(new Queue);
+    }
+
+    for (unsigned int i = 1; i <= threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(Task task)
+{
+    const auto index = currentPool == this ? currentIndex : 0;
+    {
+        auto &queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        ++pending;
+    }
+
+    // take the lock so a worker can't miss the wake up between checking pending and going to sleep
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::runPending()
+{
+    Task task;
+    if (!pop(currentPool == this ? currentIndex : 0, task)) {
+        return false;
+    }
+
+    task();
+    return true;
+}
+
+unsigned int ThreadPool::getThreadIndex()
+{
+    return currentIndex;
+}
+
+unsigned int ThreadPool::getDefaultThreadCount()
+{
+    const auto hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void ThreadPool::work(unsigned int index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        Task task;
+        if (pop(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || pending > 0; });
+        if (stopping && pending == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::pop(unsigned int index, Task &task)
+{
+    {
+        auto &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --pending;
+            return true;
+        }
+    }
+
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+        auto &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --pending;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Config.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+namespace Mix
+{
+
+/*
+    A fixed set of worker threads that run tasks.
+
+    Every worker owns a deque: it pushes and pops its own tasks at the back (so the data it just touched is still hot)
+    and steals from the front of the other deques when it runs dry. Threads that are not workers (e.g. the main thread)
+    push to a shared deque and can help out with runPending() while they wait for results.
+*/
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // starts threadCount workers, with 0 workers every task runs on the threads that call runPending()
+    explicit ThreadPool(unsigned int threadCount = getDefaultThreadCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int getThreadCount() const { return (unsigned int)threads.size(); }
+
+    void submit(Task task);
+
+    // runs one queued task on the calling thread, returns false if there was nothing to run
+    bool runPending();
+
+    /*
+        Calls fn(begin, end) for ranges of at most grainSize items that together cover [0, count). The calling thread
+        takes the first range and helps with the others until they're all done. With no more than grainSize items or
+        no workers it just calls fn(0, count).
+    */
+    template <typename Fn>
+    void parallelFor(unsigned int count, unsigned int grainSize, Fn fn);
+
+    // rounds a number of items up to whole cache lines, so ranges of a packed array never share a cache line
+    static unsigned int alignToCacheLines(unsigned int grainSize)
+    {
+        grainSize = std::max(grainSize, 1u);
+        return (grainSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    }
+
+    // 0 for threads that aren't workers of a pool, 1..getThreadCount() for the workers
+    static unsigned int getThreadIndex();
+
+    // one worker per hardware thread, minus the main thread
+    static unsigned int getDefaultThreadCount();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void work(unsigned int index);
+
+    // pops from the back of the thread's own queue, or steals from the front of another one
+    bool pop(unsigned int index, Task &task);
+
+    // index 0 is shared by the threads that aren't workers, index i belongs to worker i
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    // number of queued tasks, workers sleep while it's 0
+    std::atomic<int> pending;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+template <typename Fn>
+void ThreadPool::parallelFor(unsigned int count, unsigned int grainSize, Fn fn)
+{
+    grainSize = std::max(grainSize, 1u);
+    if (count <= grainSize || threads.empty()) {
+        fn(0u, count);
+        return;
+    }
+
+    const auto rangeCount = (count + grainSize - 1) / grainSize;
+    std::atomic<unsigned int> remaining(rangeCount - 1);
+
+    for (unsigned int range = 1; range < rangeCount; ++range) {
+        const auto begin = range * grainSize;
+        const auto end = std::min(count, begin + grainSize);
+        submit([&fn, &remaining, begin, end]() {
+            fn(begin, end);
+            --remaining;
+        });
+    }
+
+    fn(0u, grainSize);
+
+    while (remaining > 0) {
+        if (!runPending()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "Entity.h"
+#include "ThreadPool.h"
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Mix
+{
+
+/*
+    A view iterates every entity that has all of the components Ts, straight over the packed component pools.
+
+    Example:
+
+    world.view<PositionComponent, VelocityComponent>().each([](Entity e, PositionComponent &p, VelocityComponent &v) {
+        p.x += v.x;
+    });
+
+    With sparse storage the smallest pool drives the iteration and the other pools are only asked for the slot of the
+    same entity. With archetype storage the view walks the columns of every archetype that has all the components,
+    chunk by chunk. Either way there are no allocations, no shared_ptr copies and no component mask lookups.
+    Don't add or remove components while iterating, since that moves the packed data around.
+
+    A view from World::view() sees every entity in the pools, including ones created this frame that World::update()
+    hasn't handed to the systems yet. A view from System::view() only sees the system's own entities, the same ones
+    getEntities() returns: registered by the last World::update(), and still there if they were killed since.
+
+    parallelEach() splits the same iteration into ranges that run on the thread pool, so fn must only touch the
+    components it's given.
+*/
+template <typename ... Ts>
+class View
+{
+public:
+    // members, if given, limits the view to the entities whose indices it contains
+    View(EntityManager &entityManager, ThreadPool &threadPool, const SparseSet *members = nullptr)
+        : entityManager(entityManager), threadPool(threadPool), pools(entityManager.getPool<Ts>()...), members(members)
+    {
+        const int ids[] = { Component<Ts>::getId()... };
+        for (auto id : ids) {
+            mask.set(id);
+        }
+    }
+
+    // calls fn(Entity, Ts&...) for every entity that has all the components
+    template <typename Fn>
+    void each(Fn fn)
+    {
+        if (entityManager.getStorage() == Storage::Archetype) {
+            eachArchetype(fn, std::index_sequence_for<Ts...>());
+        }
+        else {
+            const SparseSet *driver = getDriver();
+            if (driver) {
+                eachSparse(fn, driver->getIndices().data(), driver->getSize(), std::index_sequence_for<Ts...>());
+            }
+        }
+    }
+
+    /*
+        Like each(), but ranges of about grainSize entities run at the same time on the thread pool. With sparse
+        storage the ranges are cut from the smallest pool and rounded up to whole cache lines, with archetype storage
+        they are made of whole chunks. Runs serially when there are no more than grainSize entities.
+    */
+    template <typename Fn>
+    void parallelEach(unsigned int grainSize, Fn fn)
+    {
+        if (entityManager.getStorage() == Storage::Archetype) {
+            parallelEachArchetype(grainSize, fn);
+            return;
+        }
+
+        const SparseSet *driver = getDriver();
+        if (!driver) {
+            return;
+        }
+
+        const auto indices = driver->getIndices().data();
+        threadPool.parallelFor(driver->getSize(), ThreadPool::alignToCacheLines(grainSize),
+            [this, &fn, indices](unsigned int begin, unsigned int end) {
+                eachSparse(fn, indices + begin, end - begin, std::index_sequence_for<Ts...>());
+            });
+    }
+
+    // upper bound on the number of entities in the view
+    unsigned int getSize() const
+    {
+        if (entityManager.getStorage() == Storage::Archetype) {
+            unsigned int size = 0;
+            for (const auto &archetype : entityManager.getArchetypeStorage().getArchetypes()) {
+                if ((archetype->getMask() & mask) == mask) {
+                    size += archetype->getSize();
+                }
+            }
+            return size;
+        }
+
+        const SparseSet *driver = getDriver();
+        return driver ? driver->getSize() : 0;
+    }
+
+private:
+    using Index = SparseSet::Index;
+
+    template <typename Fn, std::size_t ... Is>
+    void eachArchetype(Fn &fn, std::index_sequence<Is...>)
+    {
+        for (const auto &archetype : entityManager.getArchetypeStorage().getArchetypes()) {
+            if ((archetype->getMask() & mask) != mask) {
+                continue;
+            }
+
+            for (uint32_t chunk = 0; chunk < archetype->getChunkCount(); ++chunk) {
+                eachChunk(fn, *archetype, chunk, std::index_sequence<Is...>());
+            }
+        }
+    }
+
+    template <typename Fn, std::size_t ... Is>
+    void eachChunk(Fn &fn, const Archetype &archetype, uint32_t chunk, std::index_sequence<Is...>)
+    {
+        const auto count = archetype.getChunkSize(chunk);
+        const auto indices = archetype.getIndices(chunk);
+        const auto columns = std::make_tuple(archetype.template getColumn<Ts>(chunk)...);
+
+        for (uint32_t row = 0; row < count; ++row) {
+            if (members && !members->contains(indices[row])) {
+                continue;
+            }
+            fn(entityManager.getEntity(indices[row]), std::get<Is>(columns)[row]...);
+        }
+    }
+
+    template <typename Fn>
+    void parallelEachArchetype(unsigned int grainSize, Fn &fn)
+    {
+        struct ChunkRef
+        {
+            const Archetype *archetype;
+            uint32_t chunk;
+        };
+
+        std::vector<ChunkRef> chunks;
+        unsigned int size = 0;
+        for (const auto &archetype : entityManager.getArchetypeStorage().getArchetypes()) {
+            if ((archetype->getMask() & mask) == mask) {
+                for (uint32_t chunk = 0; chunk < archetype->getChunkCount(); ++chunk) {
+                    chunks.push_back({ archetype.get(), chunk });
+                }
+                size += archetype->getSize();
+            }
+        }
+
+        if (chunks.empty()) {
+            return;
+        }
+
+        // as many chunks per range as it takes to get about grainSize entities
+        const auto chunksPerRange = std::max(1u, grainSize / std::max(1u, size / (unsigned int)chunks.size()));
+        const auto serial = size <= grainSize;
+        threadPool.parallelFor((unsigned int)chunks.size(), serial ? (unsigned int)chunks.size() : chunksPerRange,
+            [this, &fn, &chunks](unsigned int begin, unsigned int end) {
+                for (auto i = begin; i < end; ++i) {
+                    eachChunk(fn, *chunks[i].archetype, chunks[i].chunk, std::index_sequence_for<Ts...>());
+                }
+            });
+    }
+
+    // runs over count indices of the driving pool
+    template <typename Fn, std::size_t ... Is>
+    void eachSparse(Fn &fn, const Index *indices, unsigned int count, std::index_sequence<Is...>)
+    {
+        for (unsigned int i = 0; i < count; ++i) {
+            const auto index = indices[i];
+            if (members && !members->contains(index)) {
+                continue;
+            }
+            const Index slots[] = { std::get<Is>(pools)->getSlot(index)... };
+
+            bool complete = true;
+            for (auto slot : slots) {
+                complete = complete && slot != SparseSet::InvalidSlot;
+            }
+            if (!complete) {
+                continue;
+            }
+
+            fn(entityManager.getEntity(index), std::get<Is>(pools)->getData()[slots[Is]]...);
+        }
+    }
+
+    // the smallest pool (or the members, if there are fewer of them), or nullptr if one of the component types has
+    // never been added
+    const SparseSet* getDriver() const
+    {
+        const SparseSet *sets[] = { std::get<SparsePool<Ts>*>(pools)... };
+        const SparseSet *driver = members;
+        for (auto set : sets) {
+            if (!set) {
+                return nullptr;
+            }
+            if (!driver || set->getSize() < driver->getSize()) {
+                driver = set;
+            }
+        }
+        return driver;
+    }
+
+    EntityManager &entityManager;
+    ThreadPool &threadPool;
+    std::tuple<SparsePool<Ts>*...> pools;
+    const SparseSet *members;
+    ComponentMask mask;
+};
+
+}
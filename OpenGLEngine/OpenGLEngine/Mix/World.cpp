@@ -1,14 +1,16 @@
 #include "World.h"
+#include <algorithm>
 #include <cassert>
 
 namespace Mix
 {
 
-World::World()
+World::World(Storage storage)
 {
-    entityManager = std::make_unique<EntityManager>(*this);
+    entityManager = std::make_unique<EntityManager>(*this, storage);
     systemManager = std::make_unique<SystemManager>(*this);
     eventManager = std::make_unique<EventManager>(*this);
+    accommodateCommandBuffers(1);
 }
 
 EntityManager& World::getEntityManager() const
@@ -31,16 +33,32 @@ EventManager& World::getEventManager() const
 
 void World::update()
 {
-    for (auto e : createdEntities) {
-        getSystemManager().addToSystems(e);
-    }
-    createdEntities.clear();
+    flushCommandBuffers();
+
+    auto &entityManager = getEntityManager();
 
+    // removals go first: swap-and-pop fills the holes from the back of the systems' lists, so doing them before
+    // appending the new entities keeps the new ones in creation order.
+    // an entity can be killed more than once in a frame, destroying it bumps its version so the copies are skipped
+    removedEntities.clear();
     for (auto e : destroyedEntities) {
-        getSystemManager().removeFromSystems(e);
-        getEntityManager().destroyEntity(e);
+        if (entityManager.isEntityAlive(e)) {
+            entityManager.destroyEntity(e);
+            removedEntities.push_back(e);
+        }
     }
     destroyedEntities.clear();
+    getSystemManager().removeFromSystems(removedEntities);
+
+    // entities that were created and killed in the same frame never reach the systems
+    createdEntities.erase(std::remove_if(createdEntities.begin(), createdEntities.end(),
+        [&entityManager](Entity e) { return !entityManager.isEntityAlive(e); }
+    ), createdEntities.end());
+    getSystemManager().addToSystems(createdEntities);
+    createdEntities.clear();
+
+    getSystemManager().updateSystems(changedEntities);
+    changedEntities.clear();
 
     getEventManager().destroyEvents();
 }
@@ -57,12 +75,111 @@ void World::destroyEntity(Entity e)
     destroyedEntities.push_back(e);
 }
 
-Entity World::getEntity(std::string tag) const
+void World::changeEntity(Entity e, const ComponentMask &previous)
+{
+    // only the first change since the systems last saw the entity needs recording, later ones are picked up with it
+    if (previous == getSystemManager().getRoutedMask(e)) {
+        changedEntities.push_back(e);
+    }
+}
+
+CommandBuffer& World::getCommandBuffer()
+{
+    const auto index = ThreadPool::getThreadIndex();
+    assert(index < commandBuffers.size());
+    return *commandBuffers[index];
+}
+
+void World::flushCommandBuffers()
+{
+    struct Recorded
+    {
+        CommandBuffer::SortKey key;
+        unsigned int buffer;
+        unsigned int command;
+    };
+
+    std::vector<Recorded> recorded;
+    std::size_t createCount = 0;
+    for (unsigned int buffer = 0; buffer < commandBuffers.size(); ++buffer) {
+        const auto &commands = commandBuffers[buffer]->commands;
+        for (unsigned int command = 0; command < commands.size(); ++command) {
+            recorded.push_back({ commands[command].key, buffer, command });
+            if (commands[command].type == CommandBuffer::Type::Create) {
+                ++createCount;
+            }
+        }
+    }
+
+    if (recorded.empty()) {
+        return;
+    }
+
+    // buffers were gathered in thread order, so a stable sort keeps thread and recording order for equal keys
+    std::stable_sort(recorded.begin(), recorded.end(), [](const Recorded &a, const Recorded &b) {
+        return a.key < b.key;
+    });
+
+    std::vector<Entity> created;
+    getEntityManager().createEntities(createCount, created);
+    createdEntities.reserve(createdEntities.size() + createCount);
+
+    // the real entity of each placeholder, per buffer
+    std::vector<std::vector<Entity>> placeholders(commandBuffers.size());
+    for (std::size_t buffer = 0; buffer < commandBuffers.size(); ++buffer) {
+        placeholders[buffer].resize(commandBuffers[buffer]->createdOutputs.size());
+    }
+
+    std::size_t nextCreated = 0;
+    for (const auto &it : recorded) {
+        auto &buffer = *commandBuffers[it.buffer];
+        const auto &command = buffer.commands[it.command];
+
+        auto e = command.entity;
+        if (CommandBuffer::isPlaceholder(e) && command.type != CommandBuffer::Type::Create) {
+            e = placeholders[it.buffer][e.getIndex()];
+            assert(CommandBuffer::isBound(e) && "placeholder used before the entity was created");
+        }
+
+        switch (command.type) {
+        case CommandBuffer::Type::Create:
+            e = created[nextCreated++];
+            placeholders[it.buffer][command.payload] = e;
+            if (buffer.createdOutputs[command.payload]) {
+                *buffer.createdOutputs[command.payload] = e;
+            }
+            createdEntities.push_back(e);
+            break;
+        case CommandBuffer::Type::AddComponent:
+            buffer.stores[command.componentId]->add(getEntityManager(), e, command.payload);
+            break;
+        case CommandBuffer::Type::RemoveComponent:
+            buffer.stores[command.componentId]->remove(getEntityManager(), e);
+            break;
+        case CommandBuffer::Type::Kill:
+            destroyEntity(e);
+            break;
+        }
+    }
+
+    for (auto &buffer : commandBuffers) {
+        buffer->clear();
+    }
+}
+
+void World::accommodateCommandBuffers(unsigned int count)
+{
+    while (commandBuffers.size() < count) {
+        commandBuffers.emplace_back(new CommandBuffer());
+    }
+}
+
+Entity World::getEntity(Name tag) const
 {
     return getEntityManager().getEntityByTag(tag);
 }
 
-std::vector<Entity> World::getGroup(std::string group) const
+Span<const Entity> World::getGroup(Name group) const
 {
     return getEntityManager().getEntityGroup(group);
 }
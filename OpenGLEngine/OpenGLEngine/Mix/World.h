@@ -7,6 +7,8 @@
 #include "Entity.h"
 #include "System.h"
 #include "Event.h"
+#include "View.h"
+#include "CommandBuffer.h"
 #include <vector>
 #include <string>
 #include <memory>
@@ -18,14 +20,16 @@ namespace Mix
 class World
 {
 public:
-    World();
+    World(Storage storage = Storage::Sparse);
 
     EntityManager& getEntityManager() const;
     SystemManager& getSystemManager() const;
     EventManager& getEventManager() const;
 
     /*
-        Updates the systems so that created/deleted entities are removed from the systems' vectors of entities.
+        Applies the commands recorded in the command buffers.
+        Updates the systems so that created/deleted entities are removed from the systems' vectors of entities, and
+        entities that gained or lost components are moved to the systems that are interested in them now.
         Updates the entity manager so that the version of a destructed entity's index is incremented.
         Destroys all the events that were created during the last frame.
     */
@@ -34,21 +38,67 @@ public:
     Entity createEntity();
     void destroyEntity(Entity e);
 
-    Entity getEntity(std::string tag) const;
-    std::vector<Entity> getGroup(std::string group) const;
+    /*
+        Returns the command buffer of the calling thread, systems that run next to other systems should record entity
+        and component changes here instead of making them directly.
+    */
+    CommandBuffer& getCommandBuffer();
+
+    /*
+        Returns a view over all entities that have the components Ts, iterated straight over the packed pools.
+        The view's parallelEach() runs on the system manager's thread pool.
+        This includes entities that aren't in any system yet, systems iterating their own entities use System::view().
+    */
+    template <typename ... Ts>
+    View<Ts...> view() const;
+
+    Entity getEntity(Name tag) const;
+    Span<const Entity> getGroup(Name group) const;
 
 	WorldData data;
 
 private:
+    void flushCommandBuffers();
+
+    // makes sure there is a command buffer for each of count threads
+    void accommodateCommandBuffers(unsigned int count);
+
+    // called by the entity manager when a component is added to or removed from an entity
+    void changeEntity(Entity e, const ComponentMask &previous);
+
     // vector of entities that are awaiting creation
     std::vector<Entity> createdEntities;
 
     // vector of entities that are awaiting destruction
     std::vector<Entity> destroyedEntities;
 
+    // entities destroyed by the last update, kept to reuse the memory
+    std::vector<Entity> removedEntities;
+
+    // vector of entities whose components changed since they were last added to the systems
+    std::vector<Entity> changedEntities;
+
     std::unique_ptr<EntityManager> entityManager = nullptr;
     std::unique_ptr<SystemManager> systemManager = nullptr;
     std::unique_ptr<EventManager> eventManager = nullptr;
+
+    // index = ThreadPool::getThreadIndex()
+    std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+
+    friend class SystemManager;
+    friend class EntityManager;
 };
 
+template <typename ... Ts>
+View<Ts...> World::view() const
+{
+    return View<Ts...>(getEntityManager(), getSystemManager().getThreadPool());
+}
+
+template <typename ... Ts>
+View<Ts...> System::view() const
+{
+    return View<Ts...>(getWorld().getEntityManager(), getThreadPool(), &entities);
+}
+
 }
@@ -7,15 +7,16 @@ namespace Reality
 	PairedSpringForceGeneratorSystem::PairedSpringForceGeneratorSystem()
 	{
 		requireComponent<PairedSpringComponent>();
+		requireReadAccess<TransformComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireMainThread();
 	}
 
 
 	void PairedSpringForceGeneratorSystem::Update(float deltaTime)
 	{
-		for (auto e : getEntities())
+		view<PairedSpringComponent>().each([&](ECSEntity e, PairedSpringComponent& spring)
 		{
-			auto &spring = e.getComponent<PairedSpringComponent>();
-
 			if (spring.entityA.hasComponent<TransformComponent>() &&
 				spring.entityB.hasComponent<TransformComponent>())
 			{
@@ -53,7 +54,7 @@ namespace Reality
 				getWorld().data.renderUtil->DrawLine(
 					entityTransformB.position, entityTransformB.position + length * direction, color);
 			}
-		}
+		});
 
 	}
 }
@@ -11,11 +11,14 @@ namespace Reality
 			inverseMass = 1 / mass;
 			accelaration = Vector3(0, 0, 0);
 			forceAccumulator = Vector3(0, 0, 0);
+			restTime = 0;
 		}
 		Vector3 velocity;
 		Vector3 accelaration;
 		float inverseMass;
 		float gravityScale;
+		// How long the particle has been slower than ParticleSleepSystem's sleep speed
+		float restTime;
 		inline void AddForce(Vector3 force)
 		{
 			forceAccumulator += force;
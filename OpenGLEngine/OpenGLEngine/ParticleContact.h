@@ -0,0 +1,38 @@
+#pragma once
+#include "ECSConfig.h"
+
+namespace Reality
+{
+	// Which features of the two bodies touch, so that contacts between the same two bodies can be told apart
+	enum ParticleContactFeature : unsigned int
+	{
+		SphereContactFeature = 0,
+		WallContactFeature = 1,		// the walls are WallContactFeature + 2 * axis, + 1 on the positive side
+		CableContactFeature = 7,
+		RodContactFeature = 8
+	};
+
+	// A contact between two particles, emitted as an event by the contact generators for the resolver of the same frame
+	struct ParticleContact
+	{
+		ParticleContact(ECSEntity a = ECSEntity(), 
+			ECSEntity b = ECSEntity(), 
+			float _restitution = 1, 
+			Vector3 _normal = Vector3(0,1,0), float _penetration = 0,
+			unsigned int _feature = SphereContactFeature):
+			entityA(a),
+			entityB(b),
+			restitution(_restitution),
+			normal(_normal),
+			penetration (_penetration),
+			feature(_feature),
+			deltaMovePerMass(Vector3(0, 0, 0)){}
+		ECSEntity entityA;
+		ECSEntity entityB;
+		float restitution;
+		Vector3 normal;
+		float penetration;
+		unsigned int feature;
+		Vector3 deltaMovePerMass;
+	};
+}
\ No newline at end of file
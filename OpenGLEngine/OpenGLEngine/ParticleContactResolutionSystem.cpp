@@ -1,15 +1,186 @@
 #include "ParticleContactResolutionSystem.h"
 #include "ParticleComponent.h"
 #include "TransformComponent.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
 
 namespace Reality
 {
+	namespace
+	{
+		using ContactLanes = ParticleContactResolutionSystem::ContactLanes;
+
+		const uint32_t LaneWidth = 4;
+		const uint32_t NoContact = 0xffffffffu;
+
+		// Cosine of the largest angle a contact's normal can turn by and still be warm started
+		const float WarmStartMinCosine = 0.95f;
+
+		// The passes of SolveIsland over lanes [begin, end), one lane at a time. Return the largest change.
+		float SolveVelocityLanesScalar(ContactLanes& lanes, Vector3* velocities, uint32_t begin, uint32_t end)
+		{
+			float largestChange = 0;
+			for (auto i = begin; i < end; i++)
+			{
+				const auto a = lanes.a[i];
+				const auto b = lanes.b[i];
+				const Vector3 normal(lanes.nx[i], lanes.ny[i], lanes.nz[i]);
+				const float separatingVelocity = glm::dot(velocities[a] - velocities[b], normal);
+				const float impulse = std::max(lanes.impulse[i] + (lanes.targetVelocity[i] - separatingVelocity) / lanes.totalInverseMass[i], 0.0f);
+				const float deltaImpulse = impulse - lanes.impulse[i];
+				lanes.impulse[i] = impulse;
+				largestChange = std::max(largestChange, std::abs(deltaImpulse));
+
+				if (a != 0)
+				{
+					velocities[a] += normal * (deltaImpulse * lanes.inverseMassA[i]);
+				}
+				if (b != 0)
+				{
+					velocities[b] -= normal * (deltaImpulse * lanes.inverseMassB[i]);
+				}
+			}
+			return largestChange;
+		}
+
+		float SolvePenetrationLanesScalar(const ContactLanes& lanes, Vector3* moves, uint32_t begin, uint32_t end)
+		{
+			float largestCorrection = 0;
+			for (auto i = begin; i < end; i++)
+			{
+				const auto a = lanes.a[i];
+				const auto b = lanes.b[i];
+				const Vector3 normal(lanes.nx[i], lanes.ny[i], lanes.nz[i]);
+				const float penetration = lanes.penetration[i] - glm::dot(moves[a] - moves[b], normal);
+				if (penetration <= 0)
+				{
+					continue;
+				}
+				largestCorrection = std::max(largestCorrection, penetration);
+
+				const auto movePerMass = normal * (penetration / lanes.totalInverseMass[i]);
+				if (a != 0)
+				{
+					moves[a] += movePerMass * lanes.inverseMassA[i];
+				}
+				if (b != 0)
+				{
+					moves[b] -= movePerMass * lanes.inverseMassB[i];
+				}
+			}
+			return largestCorrection;
+		}
+
+#ifdef REALITY_X86
+		// The bodies are gathered one lane at a time, the math is done 4 lanes at a time in the same order as the
+		// scalar passes, and the changes are scattered back one lane at a time again. No two lanes of a color share a
+		// body other than body 0, which is read but never written.
+		REALITY_TARGET_SSE void GatherLanes(const Vector3* bodies, const uint32_t* indices, __m128& x, __m128& y, __m128& z)
+		{
+			const auto& v0 = bodies[indices[0]];
+			const auto& v1 = bodies[indices[1]];
+			const auto& v2 = bodies[indices[2]];
+			const auto& v3 = bodies[indices[3]];
+			x = _mm_setr_ps(v0.x, v1.x, v2.x, v3.x);
+			y = _mm_setr_ps(v0.y, v1.y, v2.y, v3.y);
+			z = _mm_setr_ps(v0.z, v1.z, v2.z, v3.z);
+		}
+
+		REALITY_TARGET_SSE __m128 DotLanes(const ContactLanes& lanes, uint32_t i, __m128 x, __m128 y, __m128 z)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_loadu_ps(&lanes.nx[i])), _mm_mul_ps(y, _mm_loadu_ps(&lanes.ny[i]))),
+				_mm_mul_ps(z, _mm_loadu_ps(&lanes.nz[i])));
+		}
+
+		REALITY_TARGET_SSE float SolveVelocityLanesSse(ContactLanes& lanes, Vector3* velocities, uint32_t begin, uint32_t end)
+		{
+			const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+			auto largestChange = _mm_setzero_ps();
+			alignas(16) float deltaImpulses[LaneWidth];
+			for (auto i = begin; i < end; i += LaneWidth)
+			{
+				__m128 ax, ay, az, bx, by, bz;
+				GatherLanes(velocities, &lanes.a[i], ax, ay, az);
+				GatherLanes(velocities, &lanes.b[i], bx, by, bz);
+				const auto separatingVelocity = DotLanes(lanes, i, _mm_sub_ps(ax, bx), _mm_sub_ps(ay, by), _mm_sub_ps(az, bz));
+
+				const auto oldImpulse = _mm_loadu_ps(&lanes.impulse[i]);
+				const auto step = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&lanes.targetVelocity[i]), separatingVelocity), _mm_loadu_ps(&lanes.totalInverseMass[i]));
+				const auto impulse = _mm_max_ps(_mm_add_ps(oldImpulse, step), _mm_setzero_ps());
+				const auto deltaImpulse = _mm_sub_ps(impulse, oldImpulse);
+				_mm_storeu_ps(&lanes.impulse[i], impulse);
+				_mm_store_ps(deltaImpulses, deltaImpulse);
+				largestChange = _mm_max_ps(largestChange, _mm_and_ps(deltaImpulse, absMask));
+
+				for (uint32_t lane = 0; lane < LaneWidth; lane++)
+				{
+					const auto a = lanes.a[i + lane];
+					const auto b = lanes.b[i + lane];
+					const Vector3 normal(lanes.nx[i + lane], lanes.ny[i + lane], lanes.nz[i + lane]);
+					if (a != 0)
+					{
+						velocities[a] += normal * (deltaImpulses[lane] * lanes.inverseMassA[i + lane]);
+					}
+					if (b != 0)
+					{
+						velocities[b] -= normal * (deltaImpulses[lane] * lanes.inverseMassB[i + lane]);
+					}
+				}
+			}
+
+			alignas(16) float changes[LaneWidth];
+			_mm_store_ps(changes, largestChange);
+			return std::max(std::max(changes[0], changes[1]), std::max(changes[2], changes[3]));
+		}
+
+		REALITY_TARGET_SSE float SolvePenetrationLanesSse(const ContactLanes& lanes, Vector3* moves, uint32_t begin, uint32_t end)
+		{
+			auto largestCorrection = _mm_setzero_ps();
+			alignas(16) float movesPerMass[LaneWidth];
+			for (auto i = begin; i < end; i += LaneWidth)
+			{
+				__m128 ax, ay, az, bx, by, bz;
+				GatherLanes(moves, &lanes.a[i], ax, ay, az);
+				GatherLanes(moves, &lanes.b[i], bx, by, bz);
+				const auto moved = DotLanes(lanes, i, _mm_sub_ps(ax, bx), _mm_sub_ps(ay, by), _mm_sub_ps(az, bz));
+
+				// Lanes that don't penetrate (any more) are corrected by 0
+				const auto penetration = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&lanes.penetration[i]), moved), _mm_setzero_ps());
+				largestCorrection = _mm_max_ps(largestCorrection, penetration);
+				_mm_store_ps(movesPerMass, _mm_div_ps(penetration, _mm_loadu_ps(&lanes.totalInverseMass[i])));
+
+				for (uint32_t lane = 0; lane < LaneWidth; lane++)
+				{
+					const auto a = lanes.a[i + lane];
+					const auto b = lanes.b[i + lane];
+					const auto movePerMass = Vector3(lanes.nx[i + lane], lanes.ny[i + lane], lanes.nz[i + lane]) * movesPerMass[lane];
+					if (a != 0)
+					{
+						moves[a] += movePerMass * lanes.inverseMassA[i + lane];
+					}
+					if (b != 0)
+					{
+						moves[b] -= movePerMass * lanes.inverseMassB[i + lane];
+					}
+				}
+			}
+
+			alignas(16) float corrections[LaneWidth];
+			_mm_store_ps(corrections, largestCorrection);
+			return std::max(std::max(corrections[0], corrections[1]), std::max(corrections[2], corrections[3]));
+		}
+#endif
+	}
+
 	ParticleContactResolutionSystem::ParticleContactResolutionSystem()
 	{
-		requireComponent<ParticleContactComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireWriteAccess<TransformComponent>();
+		requireExclusiveAccess();
 	}
 
-	float ParticleContactResolutionSystem::CalculateSeparatingVelocity(ParticleContactComponent& contact)
+	float ParticleContactResolutionSystem::CalculateSeparatingVelocity(ParticleContact& contact)
 	{
 		Vector3 velocityA = contact.entityA.hasComponent<ParticleComponent>() ? contact.entityA.getComponent<ParticleComponent>().velocity : Vector3(0, 0, 0);
 		Vector3 velocityB = contact.entityB.hasComponent<ParticleComponent>() ? contact.entityB.getComponent<ParticleComponent>().velocity : Vector3(0, 0, 0);
@@ -17,7 +188,7 @@ namespace Reality
 		return glm::dot(relativeVel, contact.normal);
 	}
 
-	void ParticleContactResolutionSystem::ResolveVelocity(ParticleContactComponent& contact, float deltaTime)
+	void ParticleContactResolutionSystem::ResolveVelocity(ParticleContact& contact, float deltaTime)
 	{
 		float separatingVelocity = CalculateSeparatingVelocity(contact);
 
@@ -80,7 +251,7 @@ namespace Reality
 		}
 	}
 
-	void ParticleContactResolutionSystem::ResolveInterpenetration(ParticleContactComponent& contact)
+	void ParticleContactResolutionSystem::ResolveInterpenetration(ParticleContact& contact)
 	{
 		if (contact.penetration <= 0)
 		{
@@ -113,7 +284,7 @@ namespace Reality
 		//contact.penetration = 0;
 	}
 
-	void ParticleContactResolutionSystem::UpdateInterpenetration(ParticleContactComponent & bestContact, ParticleContactComponent & contact)
+	void ParticleContactResolutionSystem::UpdateInterpenetration(ParticleContact & bestContact, ParticleContact & contact)
 	{
 		bool isAvalid = contact.entityA.hasComponent<ParticleComponent>();
 		bool isBvalid = contact.entityB.hasComponent<ParticleComponent>();
@@ -136,11 +307,28 @@ namespace Reality
 	}
 
 	void ParticleContactResolutionSystem::Update(float deltaTime)
+	{
+		// The contacts are emitted as events, copy them since resolving updates them
+		auto newContacts = getWorld().getEventManager().getEvents<ParticleContact>();
+		contacts.assign(newContacts.begin(), newContacts.end());
+
+		if (solver == ContactSolver::SequentialImpulse)
+		{
+			SolveSequentialImpulse(deltaTime);
+		}
+		else
+		{
+			SolveLegacy(deltaTime);
+		}
+		contacts.clear();
+	}
+
+	void ParticleContactResolutionSystem::SolveLegacy(float deltaTime)
 	{
 		iterationsUsed = 0;
-		iterations = getEntities().size() * 2;
+		iterations = contacts.size() * 2;
 
-		if (getEntities().size() > 0)
+		if (contacts.size() > 0)
 		{
 			unsigned int bestContactIndex = 0;
 			unsigned int lastBest = 0;
@@ -148,13 +336,12 @@ namespace Reality
 			{
 				// Find the contact with the largest closing velocity
 				float max = 0;
-				for (int i = 0; i < getEntities().size(); i++)
+				for (int i = 0; i < contacts.size(); i++)
 				{
-					auto e = getEntities()[i];
-					auto &contact = e.getComponent<ParticleContactComponent>();
+					auto &contact = contacts[i];
 					if (iterationsUsed > 0)
 					{
-						UpdateInterpenetration(getEntities()[lastBest].getComponent<ParticleContactComponent>(), contact);
+						UpdateInterpenetration(contacts[lastBest], contact);
 					}
 					float sepVel = CalculateSeparatingVelocity(contact);
 					if (sepVel < max)
@@ -167,20 +354,352 @@ namespace Reality
 				{
 					break;
 				}
-				auto& bestContact = getEntities()[bestContactIndex].getComponent<ParticleContactComponent>();
+				auto& bestContact = contacts[bestContactIndex];
 				ResolveVelocity(bestContact, deltaTime);
 				ResolveInterpenetration(bestContact);
 				lastBest = bestContactIndex;
 				iterationsUsed++;
 			}
+		}
+	}
+
+	void ParticleContactResolutionSystem::SolveSequentialImpulse(float deltaTime)
+	{
+		bodyEntities.assign(1, ECSEntity());
+		bodyVelocities.assign(1, Vector3(0, 0, 0));
+		bodyAccelerations.assign(1, Vector3(0, 0, 0));
+		bodyInverseMasses.assign(1, 0.0f);
+
+		// Gather the bodies and the contacts once, the passes below only touch these arrays
+		solverContacts.clear();
+		for (const auto& contact : contacts)
+		{
+			SolverContact c;
+			c.a = GatherBody(contact.entityA);
+			c.b = GatherBody(contact.entityB);
+			c.normal = contact.normal;
+			c.totalInverseMass = bodyInverseMasses[c.a] + bodyInverseMasses[c.b];
+			c.impulse = 0;
+			c.penetration = contact.penetration - penetrationSlop;
+			c.key = GetContactKey(contact);
+			c.versionA = contact.entityA.getVersion();
+			c.versionB = contact.entityB.getVersion();
+			// Nothing can move, or there is no normal (spheres with the same center), written so NaNs are skipped too
+			if (!(c.totalInverseMass > 0) || !(glm::dot(c.normal, c.normal) > 0))
+			{
+				continue;
+			}
+
+			// Same target as the legacy solver: contacts that close bounce back with the restitution, less the velocity
+			// the acceleration built up this frame, so resting contacts don't bounce. Contacts that close slower than
+			// the threshold don't bounce at all, in a stack the bodies all fall at the same rate and that would not
+			// catch them. The threshold is 0 by default, where the target is the legacy solver's.
+			const float separatingVelocity = glm::dot(bodyVelocities[c.a] - bodyVelocities[c.b], c.normal);
+			c.targetVelocity = 0;
+			if (separatingVelocity < -restitutionThreshold)
+			{
+				c.targetVelocity = -separatingVelocity * contact.restitution;
+				const float accCausedSepVelocity = glm::dot(bodyAccelerations[c.a] - bodyAccelerations[c.b], c.normal) * deltaTime;
+				if (accCausedSepVelocity < 0)
+				{
+					c.targetVelocity = std::max(c.targetVelocity + contact.restitution * accCausedSepVelocity, 0.0f);
+				}
+			}
+
+			if (warmStarting)
+			{
+				const auto cached = contactCache.find(c.key);
+				if (cached != contactCache.end() && glm::dot(cached->second.normal, c.normal) >= WarmStartMinCosine &&
+					cached->second.versionA == c.versionA && cached->second.versionB == c.versionB)
+				{
+					c.impulse = cached->second.impulse;
+				}
+			}
+			solverContacts.push_back(c);
+		}
+
+		// The warm start impulses are applied up front, the passes only correct them. The targets above were taken
+		// before, from the velocities the bodies came in with.
+		for (const auto& c : solverContacts)
+		{
+			if (c.impulse > 0)
+			{
+				bodyVelocities[c.a] += c.normal * (c.impulse * bodyInverseMasses[c.a]);
+				bodyVelocities[c.b] -= c.normal * (c.impulse * bodyInverseMasses[c.b]);
+			}
+		}
+
+		// Contacts only affect each other through the bodies they share, so islands that share none are solved on their
+		// own, at the same time
+		islandBuilder.Reset((uint32_t)bodyEntities.size());
+		for (const auto& c : solverContacts)
+		{
+			islandBuilder.AddConstraint(c.a, c.b);
+		}
+		islandBuilder.Build();
+
+		bodyMoves.assign(bodyEntities.size(), Vector3(0, 0, 0));
+		const auto& islands = islandBuilder.GetIslands();
+
+		// Islands too large for one thread come first, each is spread over all the threads in turn
+		unsigned int firstSmall = 0;
+		while (firstSmall < islands.size() && islands[firstSmall].count >= coloringThreshold)
+		{
+			SolveIslandColored(islands[firstSmall]);
+			firstSmall++;
+		}
+
+		auto& pool = getThreadPool();
+		// A few ranges per thread, the first ones hold the largest islands
+		const auto smallCount = (unsigned int)islands.size() - firstSmall;
+		const auto grainSize = std::max(1u, smallCount / (4 * (pool.getThreadCount() + 1)));
+		pool.parallelFor(smallCount, grainSize, [this, &islands, firstSmall](unsigned int begin, unsigned int end) {
+			for (auto island = firstSmall + begin; island < firstSmall + end; island++)
+			{
+				SolveIsland(islands[island]);
+			}
+		});
+
+		contactCache.clear();
+		if (warmStarting)
+		{
+			for (const auto& c : solverContacts)
+			{
+				contactCache[c.key] = CachedContact{ c.normal, c.impulse, c.versionA, c.versionB };
+			}
+		}
+
+		// Scatter the results back
+		for (uint32_t body = 1; body < bodyEntities.size(); body++)
+		{
+			auto e = bodyEntities[body];
+			e.getComponent<ParticleComponent>().velocity = bodyVelocities[body];
+			e.getComponent<TransformComponent>().position += bodyMoves[body];
+			bodyOf[e.getIndex()] = 0;
+		}
+	}
+
+	void ParticleContactResolutionSystem::SolveIsland(const IslandBuilder::Island& island)
+	{
+		const auto* constraints = islandBuilder.GetConstraints().data() + island.first;
+
+		// Velocities, each contact in turn gets the impulse that brings it to its target given what the others did.
+		// Body 0 is shared by the islands and never moves, so it is never written.
+		for (unsigned int iteration = 0; iteration < velocityIterations; iteration++)
+		{
+			float largestChange = 0;
+			for (uint32_t i = 0; i < island.count; i++)
+			{
+				auto& c = solverContacts[constraints[i]];
+				const float separatingVelocity = glm::dot(bodyVelocities[c.a] - bodyVelocities[c.b], c.normal);
+				const float impulse = std::max(c.impulse + (c.targetVelocity - separatingVelocity) / c.totalInverseMass, 0.0f);
+				const float deltaImpulse = impulse - c.impulse;
+				c.impulse = impulse;
+				largestChange = std::max(largestChange, std::abs(deltaImpulse));
+
+				if (c.a != 0)
+				{
+					bodyVelocities[c.a] += c.normal * (deltaImpulse * bodyInverseMasses[c.a]);
+				}
+				if (c.b != 0)
+				{
+					bodyVelocities[c.b] -= c.normal * (deltaImpulse * bodyInverseMasses[c.b]);
+				}
+			}
+			if (largestChange <= impulseTolerance)
+			{
+				break;
+			}
+		}
+
+		// Penetrations, the same way on how far the bodies have been moved so far
+		for (unsigned int iteration = 0; iteration < positionIterations; iteration++)
+		{
+			float largestCorrection = 0;
+			for (uint32_t i = 0; i < island.count; i++)
+			{
+				const auto& c = solverContacts[constraints[i]];
+				const float penetration = c.penetration - glm::dot(bodyMoves[c.a] - bodyMoves[c.b], c.normal);
+				if (penetration <= 0)
+				{
+					continue;
+				}
+				largestCorrection = std::max(largestCorrection, penetration);
+
+				const auto movePerMass = c.normal * (penetration / c.totalInverseMass);
+				if (c.a != 0)
+				{
+					bodyMoves[c.a] += movePerMass * bodyInverseMasses[c.a];
+				}
+				if (c.b != 0)
+				{
+					bodyMoves[c.b] -= movePerMass * bodyInverseMasses[c.b];
+				}
+			}
+			if (largestCorrection <= penetrationTolerance)
+			{
+				break;
+			}
+		}
+	}
+
+	void ParticleContactResolutionSystem::SolveIslandColored(const IslandBuilder::Island& island)
+	{
+		const auto* constraints = islandBuilder.GetConstraints().data() + island.first;
+
+		// Contacts of the same color share no body, so each color is solved in parallel and the colors one after the
+		// other. That is a different order than SolveIsland's, the passes converge to the same impulses.
+		coloring.Reset((uint32_t)bodyEntities.size());
+		for (uint32_t i = 0; i < island.count; i++)
+		{
+			const auto& c = solverContacts[constraints[i]];
+			coloring.AddConstraint(c.a, c.b);
+		}
+		coloring.Build();
+
+		const auto& batches = coloring.GetBatches();
+		laneBatches.clear();
+		uint32_t laneCount = 0;
+		for (const auto& batch : batches)
+		{
+			const auto padded = (batch.count + LaneWidth - 1) / LaneWidth * LaneWidth;
+			laneBatches.push_back(ConstraintColoring::Batch{ laneCount, padded });
+			laneCount += padded;
+		}
+
+		// Padding lanes are between body 0 and itself with nothing to solve
+		lanes.contact.assign(laneCount, NoContact);
+		lanes.a.assign(laneCount, 0);
+		lanes.b.assign(laneCount, 0);
+		lanes.nx.assign(laneCount, 0.0f);
+		lanes.ny.assign(laneCount, 0.0f);
+		lanes.nz.assign(laneCount, 0.0f);
+		lanes.inverseMassA.assign(laneCount, 0.0f);
+		lanes.inverseMassB.assign(laneCount, 0.0f);
+		lanes.totalInverseMass.assign(laneCount, 1.0f);
+		lanes.targetVelocity.assign(laneCount, 0.0f);
+		lanes.impulse.assign(laneCount, 0.0f);
+		lanes.penetration.assign(laneCount, 0.0f);
+
+		const auto& colored = coloring.GetConstraints();
+		for (uint32_t k = 0; k < batches.size(); k++)
+		{
+			for (uint32_t j = 0; j < batches[k].count; j++)
+			{
+				const auto contact = constraints[colored[batches[k].first + j]];
+				const auto& c = solverContacts[contact];
+				const auto lane = laneBatches[k].first + j;
+				lanes.contact[lane] = contact;
+				lanes.a[lane] = c.a;
+				lanes.b[lane] = c.b;
+				lanes.nx[lane] = c.normal.x;
+				lanes.ny[lane] = c.normal.y;
+				lanes.nz[lane] = c.normal.z;
+				lanes.inverseMassA[lane] = bodyInverseMasses[c.a];
+				lanes.inverseMassB[lane] = bodyInverseMasses[c.b];
+				lanes.totalInverseMass[lane] = c.totalInverseMass;
+				lanes.targetVelocity[lane] = c.targetVelocity;
+				lanes.impulse[lane] = c.impulse;
+				lanes.penetration[lane] = c.penetration;
+			}
+		}
 
-			for (auto e : getEntities())
+		// The overflow's contacts share bodies, they are solved one after the other
+		const auto serialFrom = coloring.HasOverflow() ? (uint32_t)laneBatches.size() - 1 : (uint32_t)laneBatches.size();
+		for (unsigned int iteration = 0; iteration < velocityIterations; iteration++)
+		{
+			bool converged = true;
+			for (uint32_t k = 0; k < laneBatches.size(); k++)
+			{
+				converged = SolveColor(laneBatches[k], k >= serialFrom, false) && converged;
+			}
+			if (converged)
+			{
+				break;
+			}
+		}
+		for (uint32_t lane = 0; lane < laneCount; lane++)
+		{
+			if (lanes.contact[lane] != NoContact)
 			{
-				e.kill();
+				solverContacts[lanes.contact[lane]].impulse = lanes.impulse[lane];
 			}
 		}
 
+		for (unsigned int iteration = 0; iteration < positionIterations; iteration++)
+		{
+			bool converged = true;
+			for (uint32_t k = 0; k < laneBatches.size(); k++)
+			{
+				converged = SolveColor(laneBatches[k], k >= serialFrom, true) && converged;
+			}
+			if (converged)
+			{
+				break;
+			}
+		}
+	}
+
+	bool ParticleContactResolutionSystem::SolveColor(const ConstraintColoring::Batch& color, bool serial, bool penetrations)
+	{
+		const float tolerance = penetrations ? penetrationTolerance : impulseTolerance;
+		auto solve = [this, penetrations, serial](uint32_t begin, uint32_t end) {
+#ifdef REALITY_X86
+			if (!serial && GetSupportedSimdLevel() >= SimdLevel::Sse)
+			{
+				return penetrations ? SolvePenetrationLanesSse(lanes, bodyMoves.data(), begin, end)
+					: SolveVelocityLanesSse(lanes, bodyVelocities.data(), begin, end);
+			}
+#endif
+			return penetrations ? SolvePenetrationLanesScalar(lanes, bodyMoves.data(), begin, end)
+				: SolveVelocityLanesScalar(lanes, bodyVelocities.data(), begin, end);
+		};
+		if (serial)
+		{
+			return solve(color.first, color.first + color.count) <= tolerance;
+		}
+
+		// A few ranges per thread, in whole cache lines so that no two threads write the same one. Every range is a
+		// multiple of 4 lanes since the colors are.
+		auto& pool = getThreadPool();
+		const auto grainSize = Mix::ThreadPool::alignToCacheLines(color.count / (4 * (pool.getThreadCount() + 1)));
+		rangeChanges.assign((color.count + grainSize - 1) / grainSize, 0.0f);
+		pool.parallelFor(color.count, grainSize, [this, &color, &solve, grainSize](unsigned int begin, unsigned int end) {
+			rangeChanges[begin / grainSize] = solve(color.first + begin, color.first + end);
+		});
+		return *std::max_element(rangeChanges.begin(), rangeChanges.end()) <= tolerance;
+	}
 
+	uint64_t ParticleContactResolutionSystem::GetContactKey(const ParticleContact& contact)
+	{
+		static_assert(Mix::INDEX_BITS <= 24, "the key has room for 24 bits of each entity index");
+		return (uint64_t)contact.entityA.getIndex() << 40 | (uint64_t)contact.entityB.getIndex() << 16 | (contact.feature & 0xffff);
+	}
+
+	uint32_t ParticleContactResolutionSystem::GatherBody(ECSEntity e)
+	{
+		const auto index = e.getIndex();
+		if (index < bodyOf.size() && bodyOf[index] != 0)
+		{
+			return bodyOf[index];
+		}
+		if (!e.hasComponent<ParticleComponent>())
+		{
+			return 0;
+		}
+
+		if (index >= bodyOf.size())
+		{
+			bodyOf.resize(index + 1, 0);
+		}
+		const auto body = (uint32_t)bodyEntities.size();
+		bodyOf[index] = body;
 
+		const auto& particle = e.getComponent<ParticleComponent>();
+		bodyEntities.push_back(e);
+		bodyVelocities.push_back(particle.velocity);
+		bodyAccelerations.push_back(particle.accelaration);
+		bodyInverseMasses.push_back(particle.inverseMass);
+		return body;
 	}
 }
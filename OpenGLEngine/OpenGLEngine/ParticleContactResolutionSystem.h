@@ -1,21 +1,120 @@
 #pragma once
 #include "ECSConfig.h"
-#include "ParticleContactComponent.h"
+#include "ParticleContact.h"
+#include "IslandBuilder.h"
+#include "ConstraintColoring.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
 
 namespace Reality
 {
+	enum class ContactSolver
+	{
+		Legacy,				// resolves the contact that closes fastest, one at a time, O(n^2) in the contacts
+		SequentialImpulse	// a fixed number of passes over all the contacts, O(n) per pass
+	};
+
 	class ParticleContactResolutionSystem : public ECSSystem
 	{
 	public:
 		ParticleContactResolutionSystem();
 		void Update(float deltaTime);
 		unsigned int iterations = 1;
+		// Legacy is kept to validate the other solver against
+		ContactSolver solver = ContactSolver::Legacy;
+		// Passes of the sequential impulse solver over the velocities, then over the penetrations
+		unsigned int velocityIterations = 8;
+		unsigned int positionIterations = 4;
+		// An island stops its passes early once no impulse / no correction changes by more than these
+		float impulseTolerance = 1e-4f;
+		float penetrationTolerance = 1e-4f;
+		// Starts each contact from the impulse it ended the last frame with, if it was there and its normal hasn't
+		// turned by much. Resting contacts then start close to their answer and need only a few passes.
+		bool warmStarting = true;
+		// Contacts that close slower than this come to rest instead of bouncing. 0 bounces like the legacy solver, so
+		// the two can be compared; a few tenths settles stacks sooner.
+		float restitutionThreshold = 0;
+		// Penetration the position passes leave, so resting contacts stay touching and keep their cached impulse
+		float penetrationSlop = 0.01f;
+		// Islands with at least this many contacts are too large to leave to one thread: they are graph colored and
+		// each color is solved across the threads
+		unsigned int coloringThreshold = 1024;
+
+		// The contacts of a colored island, one lane per contact and the colors one after the other, each padded to a
+		// multiple of 4 with lanes that never do anything
+		struct ContactLanes
+		{
+			std::vector<uint32_t> contact;
+			std::vector<uint32_t> a, b;
+			std::vector<float> nx, ny, nz;
+			std::vector<float> inverseMassA, inverseMassB, totalInverseMass;
+			std::vector<float> targetVelocity, impulse, penetration;
+		};
 	private:
-		float CalculateSeparatingVelocity(ParticleContactComponent& contact);
-		void ResolveVelocity(ParticleContactComponent& contact, float deltaTime);
-		void ResolveInterpenetration(ParticleContactComponent& contact);
-		void UpdateInterpenetration(ParticleContactComponent& bestContact, ParticleContactComponent& contact);
+		void SolveLegacy(float deltaTime);
+		void SolveSequentialImpulse(float deltaTime);
+		void SolveIsland(const IslandBuilder::Island& island);
+		void SolveIslandColored(const IslandBuilder::Island& island);
+		// One pass over the lanes of a color, on the velocities or the penetrations. Returns whether no lane changed by
+		// more than the tolerance.
+		bool SolveColor(const ConstraintColoring::Batch& color, bool serial, bool penetrations);
+		// Solver body of a contact's entity, 0 (immovable) for entities without a particle
+		uint32_t GatherBody(ECSEntity e);
+		// The indices of the two entities and the feature, so contacts keep their key from frame to frame
+		static uint64_t GetContactKey(const ParticleContact& contact);
+
+		float CalculateSeparatingVelocity(ParticleContact& contact);
+		void ResolveVelocity(ParticleContact& contact, float deltaTime);
+		void ResolveInterpenetration(ParticleContact& contact);
+		void UpdateInterpenetration(ParticleContact& bestContact, ParticleContact& contact);
 		unsigned int iterationsUsed = 0;
+		// This frame's contacts, the memory is kept from frame to frame
+		std::vector<ParticleContact> contacts;
+
+		// Sequential impulse solver state, gathered from the components once per frame
+		struct SolverContact
+		{
+			uint32_t a;
+			uint32_t b;
+			Vector3 normal;
+			float totalInverseMass;
+			// separating velocity the contact should end with, with restitution
+			float targetVelocity;
+			// impulse applied so far, it can shrink again but never pull the bodies together
+			float impulse;
+			float penetration;
+			// in the padding before the key
+			ECSEntity::Version versionA;
+			ECSEntity::Version versionB;
+			uint64_t key;
+		};
+		std::vector<SolverContact> solverContacts;
+		// Body 0 stands for everything without a particle, it has no inverse mass so it never moves
+		std::vector<ECSEntity> bodyEntities;
+		std::vector<Vector3> bodyVelocities;
+		std::vector<Vector3> bodyAccelerations;
+		std::vector<float> bodyInverseMasses;
+		std::vector<Vector3> bodyMoves;
+		// index = entity index, 0 until the entity is gathered
+		std::vector<uint32_t> bodyOf;
+		IslandBuilder islandBuilder;
+		// Normal and impulse of last frame's contacts, by contact key
+		struct CachedContact
+		{
+			Vector3 normal;
+			float impulse;
+			// The key only has room for the indices, an entity that took over a dead one's index doesn't match these
+			ECSEntity::Version versionA;
+			ECSEntity::Version versionB;
+		};
+		std::unordered_map<uint64_t, CachedContact> contactCache;
+		ConstraintColoring coloring;
+		ContactLanes lanes;
+		// lanes of each color, the last one's contacts share bodies if the coloring overflowed
+		std::vector<ConstraintColoring::Batch> laneBatches;
+		// largest change of each range of a parallel pass
+		std::vector<float> rangeChanges;
 	};
 }
 
@@ -0,0 +1,101 @@
+#pragma once
+#include "ECSConfig.h"
+
+namespace Reality
+{
+	/*
+		Ways to step a particle's position and velocity over deltaTime. Each is a struct with a static Step that takes
+		the acceleration as a callable, acceleration(position, velocity), and calls it as often as the method needs.
+		They are template arguments rather than virtual classes, so the loop over the particles is compiled once per
+		method with the calls inlined.
+
+		Step returns the acceleration at the start of the step, what ParticleComponent::accelaration holds. MeanVelocity
+		is the velocity that moved a particle over a step that ended with velocity, under a constant acceleration: the
+		step's displacement over deltaTime, so the step can be taken back and done again.
+	*/
+
+	// Acceleration that doesn't depend on where the particle is or how fast it goes, e.g. the accumulated force and
+	// gravity of the step
+	struct ConstantAcceleration
+	{
+		Vector3 acceleration;
+		const Vector3& operator()(const Vector3&, const Vector3&) const { return acceleration; }
+	};
+
+	// Velocity first, then position with the new velocity. First order but symplectic, energy doesn't drift away.
+	// One evaluation of the acceleration.
+	struct SymplecticEuler
+	{
+		template<typename Acceleration>
+		static Vector3 Step(Vector3& position, Vector3& velocity, const Acceleration& acceleration, float deltaTime)
+		{
+			const Vector3 start = acceleration(position, velocity);
+			velocity = velocity + start * deltaTime;
+			position = position + velocity * deltaTime;
+			return start;
+		}
+
+		static Vector3 MeanVelocity(const Vector3& velocity, const Vector3&, float)
+		{
+			return velocity;
+		}
+	};
+
+	// Position Verlet, x' = 2x - x_previous + a dt^2, is the same recurrence as symplectic Euler once the velocity is
+	// taken as (x - x_previous) / dt. The velocity is kept anyway for contacts and springs, so it stands in for the
+	// previous position.
+	using PositionVerlet = SymplecticEuler;
+
+	// Position from the start's velocity and acceleration, velocity from the mean of the start's and the end's
+	// acceleration. Second order and symplectic, two evaluations of the acceleration. Exact under a constant
+	// acceleration, so thrown particles follow their parabola whatever the step.
+	struct VelocityVerlet
+	{
+		template<typename Acceleration>
+		static Vector3 Step(Vector3& position, Vector3& velocity, const Acceleration& acceleration, float deltaTime)
+		{
+			const Vector3 start = acceleration(position, velocity);
+			position = position + velocity * deltaTime + start * (0.5f * deltaTime * deltaTime);
+			// The end's velocity isn't known yet, forces that depend on it see the one the start's acceleration gives
+			const Vector3 end = acceleration(position, velocity + start * deltaTime);
+			velocity = velocity + (start + end) * (0.5f * deltaTime);
+			return start;
+		}
+
+		static Vector3 MeanVelocity(const Vector3& velocity, const Vector3& acceleration, float deltaTime)
+		{
+			return velocity - acceleration * (0.5f * deltaTime);
+		}
+	};
+
+	// Classic fourth order Runge-Kutta, four evaluations of the acceleration. Not symplectic, but far more accurate
+	// per step than the others where the acceleration changes along the way, so it can take much larger steps. Only
+	// for accelerations that are functions of the state: under the constant acceleration ParticleIntegrationSystem
+	// gathers it gives velocity Verlet's parabola with twice the evaluations, so that system doesn't offer it.
+	struct RungeKutta4
+	{
+		template<typename Acceleration>
+		static Vector3 Step(Vector3& position, Vector3& velocity, const Acceleration& acceleration, float deltaTime)
+		{
+			const float halfStep = 0.5f * deltaTime;
+			const Vector3 v1 = velocity;
+			const Vector3 a1 = acceleration(position, v1);
+			const Vector3 v2 = velocity + a1 * halfStep;
+			const Vector3 a2 = acceleration(position + v1 * halfStep, v2);
+			const Vector3 v3 = velocity + a2 * halfStep;
+			const Vector3 a3 = acceleration(position + v2 * halfStep, v3);
+			const Vector3 v4 = velocity + a3 * deltaTime;
+			const Vector3 a4 = acceleration(position + v3 * deltaTime, v4);
+
+			const float sixthStep = deltaTime / 6;
+			position = position + (v1 + 2.0f * (v2 + v3) + v4) * sixthStep;
+			velocity = velocity + (a1 + 2.0f * (a2 + a3) + a4) * sixthStep;
+			return a1;
+		}
+
+		static Vector3 MeanVelocity(const Vector3& velocity, const Vector3& acceleration, float deltaTime)
+		{
+			return velocity - acceleration * (0.5f * deltaTime);
+		}
+	};
+}
@@ -0,0 +1,37 @@
+#include "ParticleIntegrationSystem.h"
+
+
+namespace Reality
+{
+	ParticleIntegrationSystem::ParticleIntegrationSystem()
+	{
+		requireComponent<TransformComponent>();
+		requireComponent<ParticleComponent>();
+		requireWriteAccess<TransformComponent>();
+		requireWriteAccess<ParticleComponent>();
+	}
+
+	void ParticleIntegrationSystem::Update(float deltaTime)
+	{
+		switch (method)
+		{
+		case IntegrationMethod::VelocityVerlet:
+			Integrate<VelocityVerlet>(deltaTime);
+			break;
+		default:
+			Integrate<SymplecticEuler>(deltaTime);
+			break;
+		}
+	}
+
+	template<typename Method>
+	void ParticleIntegrationSystem::Integrate(float deltaTime)
+	{
+		view<TransformComponent, ParticleComponent>().parallelEach(Mix::DEFAULT_GRAIN_SIZE, [&](ECSEntity, TransformComponent& transform, ParticleComponent& particle)
+		{
+			particle.accelaration = IntegrateParticle<Method>(transform.position, particle.velocity, particle.GetForce(),
+				particle.inverseMass, particle.gravityScale, gravity, deltaTime);
+			particle.ResetForceAccumulator();
+		});
+	}
+}
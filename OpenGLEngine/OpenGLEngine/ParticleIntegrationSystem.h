@@ -0,0 +1,43 @@
+#pragma once
+#include "ECSConfig.h"
+#include "TransformComponent.h"
+#include "ParticleComponent.h"
+#include "ParticleIntegrator.h"
+
+namespace Reality
+{
+	// RungeKutta4 isn't one of them. The system only has each particle's acceleration at the start of the step, and
+	// taking the springs again at RK4's stages would mean running the whole spring network four times per step. It is
+	// only a policy, for code that steps particles with an acceleration it can evaluate anywhere.
+	enum class IntegrationMethod
+	{
+		SymplecticEuler,	// what ParticleSystem does, one evaluation, first order (also stands for position Verlet)
+		VelocityVerlet		// second order, exact for the constant acceleration of a step
+	};
+
+	/*
+		Does what GravityForceGeneratorSystem, ForceAccumulatorSystem and ParticleSystem do one after the other, in one
+		pass over the particles, so their components are read and written once per step instead of three times. Force
+		generators that run before it still add to the particles' accumulators.
+
+		Particles with infinite mass don't fall, GravityForceGeneratorSystem divides by their inverse mass and turns
+		them into NaN.
+
+		The method is picked once per update, each one has its own loop over the particles with no dispatch inside.
+	*/
+	class ParticleIntegrationSystem : public ECSSystem
+	{
+	public:
+		Vector3 gravity = Vector3(0, -9.8f, 0);
+		// Forces are gathered by the generators before the step, so all methods see them as constant over it and the
+		// higher orders only pay off for the motion itself. DistanceConstraintSystem takes the step back with the same
+		// method.
+		IntegrationMethod method = IntegrationMethod::SymplecticEuler;
+		ParticleIntegrationSystem();
+		void Update(float deltaTime);
+
+	private:
+		template<typename Method>
+		void Integrate(float deltaTime);
+	};
+}
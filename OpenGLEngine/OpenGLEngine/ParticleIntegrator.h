@@ -0,0 +1,16 @@
+#pragma once
+#include "ECSConfig.h"
+#include "ParticleIntegrationMethods.h"
+
+namespace Reality
+{
+	// One particle of the integration: the acceleration from the accumulated force and gravity, then a step of the
+	// method. Particles with infinite mass (no inverse mass) don't fall. Returns the acceleration.
+	template<typename Method = SymplecticEuler>
+	inline Vector3 IntegrateParticle(Vector3& position, Vector3& velocity, const Vector3& force, float inverseMass, float gravityScale,
+		const Vector3& gravity, float deltaTime)
+	{
+		const float gravityFactor = inverseMass > 0 ? gravityScale : 0.0f;
+		return Method::Step(position, velocity, ConstantAcceleration{ force * inverseMass + gravity * gravityFactor }, deltaTime);
+	}
+}
@@ -0,0 +1,371 @@
+#include "ParticleSleepSystem.h"
+#include "ParticleContact.h"
+#include "PairedSpringComponent.h"
+#include "BungeeComponent.h"
+#include "CableComponent.h"
+#include "RodComponent.h"
+#include "FixedSpringComponent.h"
+#include "BuoyancyComponent.h"
+#include <algorithm>
+
+namespace Reality
+{
+	namespace
+	{
+		uint64_t GetLinkKey(ECSEntity e, uint32_t kind)
+		{
+			return (uint64_t)e.getIndex() << 3 | kind;
+		}
+	}
+
+	ParticleSleepSystem::ParticleSleepSystem()
+	{
+		requireComponent<ParticleComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireWriteAccess<SleepingParticleComponent>();
+		requireExclusiveAccess();
+		// Group 0 is for particles put to sleep by something else
+		groups.emplace_back();
+	}
+
+	void ParticleSleepSystem::Update(float deltaTime)
+	{
+		WakeBrokenGroups();
+
+		// Particles that stayed slow count how long they have rested
+		const float sleepSpeedSquared = sleepSpeed * sleepSpeed;
+		for (auto e : getEntities())
+		{
+			auto& particle = e.getComponent<ParticleComponent>();
+			if (glm::dot(particle.velocity, particle.velocity) >= sleepSpeedSquared)
+			{
+				particle.restTime = 0;
+			}
+			else
+			{
+				particle.restTime += deltaTime;
+			}
+		}
+
+		// Links that were added or removed or changed ends wake both ends, whatever held them at rest has changed
+		GatherLinks();
+		auto link = links.begin();
+		auto previous = previousLinks.begin();
+		while (link != links.end() || previous != previousLinks.end())
+		{
+			if (previous == previousLinks.end() || (link != links.end() && link->key < previous->key))
+			{
+				Wake(link->a);
+				Wake(link->b);
+				++link;
+			}
+			else if (link == links.end() || previous->key < link->key)
+			{
+				Wake(previous->a);
+				Wake(previous->b);
+				++previous;
+			}
+			else
+			{
+				if (!link->a.isSame(previous->a) || !link->b.isSame(previous->b))
+				{
+					Wake(link->a);
+					Wake(link->b);
+					Wake(previous->a);
+					Wake(previous->b);
+				}
+				else
+				{
+					WakeLinked(link->a, link->b);
+				}
+				++link;
+				++previous;
+			}
+		}
+
+		FallAsleep();
+		std::swap(links, previousLinks);
+	}
+
+	void ParticleSleepSystem::WakeTouched()
+	{
+		// This frame's contacts, with spheres, walls, and cables and rods that are taut
+		for (const auto& contact : getWorld().getEventManager().getEvents<ParticleContact>())
+		{
+			WakeLinked(contact.entityA, contact.entityB);
+		}
+	}
+
+	void ParticleSleepSystem::Wake(ECSEntity e)
+	{
+		if (!e.isAlive() || !e.hasComponent<SleepingParticleComponent>())
+		{
+			return;
+		}
+
+		const auto group = e.getComponent<SleepingParticleComponent>().group;
+		if (group != 0)
+		{
+			WakeGroup(group);
+			return;
+		}
+
+		// Put to sleep by something else, it has no group
+		const auto particle = e.getComponent<SleepingParticleComponent>().particle;
+		e.removeComponent<SleepingParticleComponent>();
+		e.addComponent<ParticleComponent>(particle);
+	}
+
+	void ParticleSleepSystem::WakeGroup(uint32_t group)
+	{
+		if (groups[group].empty())
+		{
+			return;
+		}
+		// Waking moves the members out of the group before anything can look at it again
+		auto members = std::move(groups[group]);
+		groups[group].clear();
+		freeGroups.push_back(group);
+
+		for (auto e : members)
+		{
+			if (!e.isAlive() || !e.hasComponent<SleepingParticleComponent>())
+			{
+				continue;
+			}
+			const auto& sleeping = e.getComponent<SleepingParticleComponent>();
+			if (sleeping.group != group)
+			{
+				continue;
+			}
+			auto particle = sleeping.particle;
+			particle.restTime = 0;
+			e.removeComponent<SleepingParticleComponent>();
+			e.addComponent<ParticleComponent>(particle);
+		}
+	}
+
+	void ParticleSleepSystem::WakeBrokenGroups()
+	{
+		for (uint32_t group = 1; group < groups.size(); ++group)
+		{
+			for (auto e : groups[group])
+			{
+				// Died, or woken or changed by something else: whatever rested on it may fall now
+				if (!e.isAlive() || !e.hasComponent<SleepingParticleComponent>() ||
+					e.getComponent<SleepingParticleComponent>().group != group)
+				{
+					WakeGroup(group);
+					break;
+				}
+			}
+		}
+	}
+
+	void ParticleSleepSystem::FallAsleep()
+	{
+		// Islands of this frame's contacts and links, between particles that are awake or asleep
+		nodeEntities.clear();
+		nodeEntities.push_back(ECSEntity());
+		constraintNodes.clear();
+		auto addConstraint = [this](ECSEntity a, ECSEntity b)
+		{
+			const auto nodeA = GetNode(a);
+			const auto nodeB = GetNode(b);
+			if (nodeA != nodeB)
+			{
+				constraintNodes.push_back(nodeA);
+				constraintNodes.push_back(nodeB);
+			}
+		};
+		for (const auto& contact : getWorld().getEventManager().getEvents<ParticleContact>())
+		{
+			addConstraint(contact.entityA, contact.entityB);
+		}
+		for (const auto& link : links)
+		{
+			addConstraint(link.a, link.b);
+		}
+		// Particles that touch nothing are islands of their own
+		for (auto e : getEntities())
+		{
+			GetNode(e);
+		}
+
+		const auto nodeCount = (uint32_t)nodeEntities.size();
+		islandBuilder.Reset(nodeCount);
+		for (size_t i = 0; i < constraintNodes.size(); i += 2)
+		{
+			islandBuilder.AddConstraint(constraintNodes[i], constraintNodes[i + 1]);
+		}
+		islandBuilder.Build();
+
+		// Islands of the constraints first, then one for each node that has none
+		const auto& islands = islandBuilder.GetIslands();
+		const auto& constraints = islandBuilder.GetConstraints();
+		const uint32_t none = ~0u;
+		islandOf.assign(nodeCount, none);
+		for (uint32_t island = 0; island < islands.size(); ++island)
+		{
+			for (uint32_t i = islands[island].first; i < islands[island].first + islands[island].count; ++i)
+			{
+				const auto c = constraints[i];
+				islandOf[constraintNodes[2 * c]] = island;
+				islandOf[constraintNodes[2 * c + 1]] = island;
+			}
+		}
+		auto islandCount = (uint32_t)islands.size();
+		for (uint32_t node = 1; node < nodeCount; ++node)
+		{
+			if (islandOf[node] == none)
+			{
+				islandOf[node] = islandCount++;
+			}
+		}
+
+		// An island sleeps once it has awake particles and all of them have rested long enough
+		islandRested.assign(islandCount, 0);
+		for (uint32_t node = 1; node < nodeCount; ++node)
+		{
+			auto e = nodeEntities[node];
+			if (e.hasComponent<ParticleComponent>() && islandRested[islandOf[node]] != 2)
+			{
+				islandRested[islandOf[node]] = e.getComponent<ParticleComponent>().restTime >= sleepTime ? 1 : 2;
+			}
+		}
+
+		// Each island that sleeps becomes a group, taking in the sleeping groups it touches
+		auto& commands = getWorld().getCommandBuffer();
+		std::vector<uint32_t> groupOfIsland(islandCount, 0);
+		for (uint32_t node = 1; node < nodeCount; ++node)
+		{
+			const auto island = islandOf[node];
+			if (islandRested[island] != 1)
+			{
+				continue;
+			}
+			if (groupOfIsland[island] == 0)
+			{
+				if (freeGroups.empty())
+				{
+					freeGroups.push_back((uint32_t)groups.size());
+					groups.emplace_back();
+				}
+				groupOfIsland[island] = freeGroups.back();
+				freeGroups.pop_back();
+			}
+			const auto group = groupOfIsland[island];
+
+			auto e = nodeEntities[node];
+			if (e.hasComponent<ParticleComponent>())
+			{
+				auto particle = e.getComponent<ParticleComponent>();
+				particle.velocity = Vector3(0, 0, 0);
+				particle.accelaration = Vector3(0, 0, 0);
+				particle.ResetForceAccumulator();
+				particle.restTime = 0;
+				commands.removeComponent<ParticleComponent>(e);
+				commands.addComponent<SleepingParticleComponent>(e, SleepingParticleComponent(particle, group));
+				groups[group].push_back(e);
+				continue;
+			}
+
+			const auto sleepingGroup = e.getComponent<SleepingParticleComponent>().group;
+			if (sleepingGroup == group)
+			{
+				continue;
+			}
+			if (sleepingGroup == 0)
+			{
+				e.getComponent<SleepingParticleComponent>().group = group;
+				groups[group].push_back(e);
+				continue;
+			}
+			for (auto member : groups[sleepingGroup])
+			{
+				member.getComponent<SleepingParticleComponent>().group = group;
+				groups[group].push_back(member);
+			}
+			groups[sleepingGroup].clear();
+			freeGroups.push_back(sleepingGroup);
+		}
+
+		for (size_t node = 1; node < nodeEntities.size(); ++node)
+		{
+			nodeOf[nodeEntities[node].getIndex()] = 0;
+		}
+	}
+
+	uint32_t ParticleSleepSystem::GetNode(ECSEntity e)
+	{
+		if (!e.isAlive() || (!e.hasComponent<ParticleComponent>() && !e.hasComponent<SleepingParticleComponent>()))
+		{
+			return 0;
+		}
+		const auto index = e.getIndex();
+		if (index >= nodeOf.size())
+		{
+			nodeOf.resize(index + 1, 0);
+		}
+		if (nodeOf[index] == 0)
+		{
+			nodeOf[index] = (uint32_t)nodeEntities.size();
+			nodeEntities.push_back(e);
+		}
+		return nodeOf[index];
+	}
+
+	void ParticleSleepSystem::GatherLinks()
+	{
+		links.clear();
+		auto& world = getWorld();
+		world.view<PairedSpringComponent>().each([this](ECSEntity e, PairedSpringComponent& spring)
+		{
+			links.push_back(Link{ GetLinkKey(e, 0), spring.entityA, spring.entityB });
+		});
+		world.view<BungeeComponent>().each([this](ECSEntity e, BungeeComponent& bungee)
+		{
+			links.push_back(Link{ GetLinkKey(e, 1), bungee.entityA, bungee.entityB });
+		});
+		world.view<CableComponent>().each([this](ECSEntity e, CableComponent& cable)
+		{
+			links.push_back(Link{ GetLinkKey(e, 2), cable.entityA, cable.entityB });
+		});
+		world.view<RodComponent>().each([this](ECSEntity e, RodComponent& rod)
+		{
+			links.push_back(Link{ GetLinkKey(e, 3), rod.entityA, rod.entityB });
+		});
+		world.view<FixedSpringComponent>().each([this](ECSEntity e, FixedSpringComponent& spring)
+		{
+			links.push_back(Link{ GetLinkKey(e, 4), spring.entity, spring.entity });
+		});
+		world.view<BuoyancyComponent>().each([this](ECSEntity e, BuoyancyComponent& buoyancy)
+		{
+			links.push_back(Link{ GetLinkKey(e, 5), buoyancy.entity, buoyancy.entity });
+		});
+		std::sort(links.begin(), links.end());
+	}
+
+	void ParticleSleepSystem::WakeLinked(ECSEntity a, ECSEntity b)
+	{
+		if (IsMoving(a))
+		{
+			Wake(b);
+		}
+		if (IsMoving(b))
+		{
+			Wake(a);
+		}
+	}
+
+	bool ParticleSleepSystem::IsMoving(ECSEntity e) const
+	{
+		if (!e.isAlive() || !e.hasComponent<ParticleComponent>())
+		{
+			return false;
+		}
+		// Particles that rested at the end of the last step only gained this step's gravity, they're still resting
+		const auto& particle = e.getComponent<ParticleComponent>();
+		return particle.restTime == 0 && glm::dot(particle.velocity, particle.velocity) >= sleepSpeed * sleepSpeed;
+	}
+}
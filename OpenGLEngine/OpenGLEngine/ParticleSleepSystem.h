@@ -0,0 +1,83 @@
+#pragma once
+#include "ECSConfig.h"
+#include "ParticleComponent.h"
+#include "SleepingParticleComponent.h"
+#include "IslandBuilder.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Puts particles that have come to rest to sleep, and wakes them again when something could move them.
+
+		Particles that touch, or are linked by a spring, bungee, cable or rod, form an island. When every particle of
+		an island has stayed slower than sleepSpeed for sleepTime seconds, the whole island falls asleep together as
+		one group: their ParticleComponents are swapped for SleepingParticleComponents holding the group. The force
+		generators, the integrator and the solvers only look at ParticleComponents, so they don't touch them any more,
+		and with archetype storage they aren't even in the arrays they walk. Spheres still stop awake spheres while
+		they sleep, as if they were static. An island that touches a sleeping group joins it when it falls asleep.
+
+		Waking one particle wakes its whole group, so nothing is left resting on something that went away. A group
+		wakes when a particle moving faster than sleepSpeed touches or is linked to one of its particles, when a link
+		to one of them is added, removed or changes ends, and when one of them dies or stops sleeping some other way.
+		Code that pushes a sleeping particle some other way calls Wake.
+
+		WakeTouched runs between the contact generation and the contact resolution: it wakes the groups that moving
+		particles ran into, in place, so the resolver sees them as the particles they are and they take the hit.
+		Update runs after the contacts have been resolved and puts islands to sleep with the next world update.
+	*/
+	class ParticleSleepSystem : public ECSSystem
+	{
+	public:
+		ParticleSleepSystem();
+		void Update(float deltaTime);
+		void WakeTouched();
+		float sleepSpeed = 0.1f;
+		float sleepTime = 0.5f;
+		// Does nothing for particles that are awake. Swaps the components right away, so only call it where nothing
+		// else runs next to the caller.
+		void Wake(ECSEntity e);
+	private:
+		// Something that moves both its entities, a and b are the same for links with one end
+		struct Link
+		{
+			// entity of the link's component and which kind of link it is
+			uint64_t key;
+			ECSEntity a;
+			ECSEntity b;
+			bool operator<(const Link& other) const { return key < other.key; }
+		};
+		void GatherLinks();
+		// Wakes whichever end of the link sleeps if the other end moves
+		void WakeLinked(ECSEntity a, ECSEntity b);
+		bool IsMoving(ECSEntity e) const;
+
+		void WakeGroup(uint32_t group);
+		// Wakes the groups that lost a particle since the last update
+		void WakeBrokenGroups();
+		// Puts the islands whose particles have all rested long enough to sleep
+		void FallAsleep();
+		// Island node of a particle, awake or asleep, 0 for anything else
+		uint32_t GetNode(ECSEntity e);
+
+		// Links of this update and the last one, sorted by entity
+		std::vector<Link> links;
+		std::vector<Link> previousLinks;
+
+		// Particles of each sleeping group, empty for unused groups, index = group
+		std::vector<std::vector<ECSEntity>> groups;
+		std::vector<uint32_t> freeGroups;
+
+		IslandBuilder islandBuilder;
+		// Entity of each island node, node 0 stands for everything that isn't a particle
+		std::vector<ECSEntity> nodeEntities;
+		// index = entity index, 0 if the entity has no node yet
+		std::vector<uint32_t> nodeOf;
+		// Ends of the constraints given to the island builder
+		std::vector<uint32_t> constraintNodes;
+		// Island of each node, and whether all of its awake particles rested long enough, index = node / island
+		std::vector<uint32_t> islandOf;
+		std::vector<uint8_t> islandRested;
+	};
+}
@@ -8,10 +8,13 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<ParticleSpawnerComponent>();
+		requireWriteAccess<ParticleSpawnerComponent>();
 	}
 
 	void ParticleSpawnerSystem::Update(float deltaTime)
 	{
+		// The particles are created with the next world update, so the spawner can run next to other systems
+		auto& commands = getWorld().getCommandBuffer();
 		for (auto e : getEntities())
 		{
 			auto &particleSpawner = e.getComponent<ParticleSpawnerComponent>();
@@ -25,8 +28,8 @@ namespace Reality
 				float deltaAngle = 2 * 3.14f / particleSpawner.numberOfParticles;
 				for (int i = 0; i < particleSpawner.numberOfParticles; i++)
 				{
-					auto e = getWorld().createEntity();
-					e.addComponent<TransformComponent>(transform.position, Vector3(0.1f, 0.1f, 0.1f));
+					auto e = commands.createEntity();
+					commands.addComponent<TransformComponent>(e, transform.position, Vector3(0.1f, 0.1f, 0.1f));
 
 					// Calculate velocity, spread out in a circle
 					Vector3 velocity;
@@ -36,10 +39,10 @@ namespace Reality
 					velocity.z = sin(angle) * particleSpawner.particleSpeed;
 
 					// Add particle with gravity
-					e.addComponent<ParticleComponent>(1.0f, velocity);
+					commands.addComponent<ParticleComponent>(e, 1.0f, velocity);
 
 					// Add mesh
-					e.addComponent<ModelComponent>("Resources/Models/nanosuit/nanosuit.obj");
+					commands.addComponent<ModelComponent>(e, "Resources/Models/nanosuit/nanosuit.obj");
 				}
 
 				// Reset timer
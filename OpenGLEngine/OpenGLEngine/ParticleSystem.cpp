@@ -7,15 +7,14 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<ParticleComponent>();
+		requireWriteAccess<TransformComponent>();
+		requireWriteAccess<ParticleComponent>();
 	}
 
 	void ParticleSystem::Update(float deltaTime)
 	{
-		for (auto e : getEntities())
+		view<TransformComponent, ParticleComponent>().parallelEach(Mix::DEFAULT_GRAIN_SIZE, [&](ECSEntity e, TransformComponent& transform, ParticleComponent& particle)
 		{
-			auto &particle = e.getComponent<ParticleComponent>();
-			auto &transform = e.getComponent<TransformComponent>();
-
 			// HACK for bounce
 			if (transform.position.y <= -10)
 			{
@@ -28,6 +27,6 @@ namespace Reality
 
 			// Update position from velocity
 			transform.position += particle.velocity * deltaTime;
-		}
+		});
 	}
 }
@@ -9,6 +9,8 @@ namespace Reality
 	{
 		requireComponent<TransformComponent>();
 		requireComponent<ModelComponent>();
+		requireWriteAccess<ModelComponent>();
+		requireMainThread();
 	}
 
 	void RenderingSystem::Update(float deltaTime)
@@ -23,11 +25,8 @@ namespace Reality
 		{
 			drawModeChanged = false;
 		}
-		for (auto e : getEntities()) 
+		view<TransformComponent, ModelComponent>().each([&](ECSEntity e, const TransformComponent& transform, ModelComponent& mesh)
 		{
-			const auto transform = e.getComponent<TransformComponent>();
-			auto &mesh = e.getComponent<ModelComponent>();
-
 			getWorld().data.renderUtil->SetFOV(45);
 			getWorld().data.renderUtil->UpdateViewMatrix();
 			if (getWorld().data.assetLoader->ModelsLoaded())
@@ -47,7 +46,7 @@ namespace Reality
 			//getWorld().data.renderUtil->DrawCube(transform.position, Vector3(10,10,10), transform.eulerAngles);
 			//getWorld().data.renderUtil->DrawCube(transform.position + Vector3(0, transform.scale.y , 0) * 7.5f, transform.scale * 15.0f, transform.eulerAngles);
 			//getWorld().data.renderUtil->DrawLine(transform.position - Vector3(1, 1, 1), transform.position + Vector3(1, 1, 1));
-		}
+		});
 	}
 }
 
@@ -5,11 +5,13 @@ namespace Reality
 {
 	struct RodComponent
 	{
-		RodComponent(ECSEntity a = ECSEntity(), ECSEntity b = ECSEntity(), float _length = 10)
-			: entityA(a), entityB(b), length(_length)
+		RodComponent(ECSEntity a = ECSEntity(), ECSEntity b = ECSEntity(), float _length = 10, float _compliance = 0)
+			: entityA(a), entityB(b), length(_length), compliance(_compliance)
 		{}
 		ECSEntity entityA;
 		ECSEntity entityB;
 		float length;
+		// 0 for a rigid rod, otherwise the inverse of its stiffness (DistanceConstraintSystem only)
+		float compliance;
 	};
 }
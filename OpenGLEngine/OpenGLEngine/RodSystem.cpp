@@ -1,16 +1,20 @@
 #include "RodSystem.h"
 #include "TransformComponent.h"
-#include "ParticleContactComponent.h"
+#include "ParticleContact.h"
+#include <cmath>
 
 namespace Reality
 {
 	RodSystem::RodSystem()
 	{
 		requireComponent<RodComponent>();
+		requireReadAccess<TransformComponent>();
+		requireMainThread();
 	}
 
 	void RodSystem::Update(float deltaTime)
 	{
+		auto& events = getWorld().getEventManager();
 		for (auto e : getEntities())
 		{
 			auto& rod = e.getComponent<RodComponent>();
@@ -20,7 +24,8 @@ namespace Reality
 			getWorld().data.renderUtil->DrawSphere(rod.entityA.getComponent<TransformComponent>().position, 1, Color::Purple);
 			getWorld().data.renderUtil->DrawSphere(rod.entityB.getComponent<TransformComponent>().position, 1, Color::Purple);
 
-			if (currentLength == rod.length)
+			// Lengths that come out of float math are almost never exactly equal
+			if (std::abs(currentLength - rod.length) <= lengthTolerance)
 			{
 				continue;
 			}
@@ -31,26 +36,26 @@ namespace Reality
 
 			if (currentLength > rod.length)
 			{
-				auto contactEntity = getWorld().createEntity();
-				contactEntity.addComponent<ParticleContactComponent>(
+				events.emitEvent<ParticleContact>(
 					rod.entityA,
 					rod.entityB,
 					0,
 					normal,
-					currentLength - rod.length);
+					currentLength - rod.length,
+					RodContactFeature);
 				getWorld().data.renderUtil->DrawLine(rod.entityA.getComponent<TransformComponent>().position,
 					rod.entityB.getComponent<TransformComponent>().position,
 					Color::Yellow);
 			}
 			else
 			{
-				auto contactEntity = getWorld().createEntity();
-				contactEntity.addComponent<ParticleContactComponent>(
+				events.emitEvent<ParticleContact>(
 					rod.entityA,
 					rod.entityB,
 					0,
 					-normal,
-					rod.length - currentLength);
+					rod.length - currentLength,
+					RodContactFeature);
 				getWorld().data.renderUtil->DrawLine(rod.entityA.getComponent<TransformComponent>().position,
 					rod.entityB.getComponent<TransformComponent>().position,
 					Color::Yellow);
@@ -9,5 +9,7 @@ namespace Reality
 	public:
 		RodSystem();
 		void Update(float deltaTime);
+		// Rods that are off by no more than this don't make a contact
+		float lengthTolerance = 0.001f;
 	};
 }
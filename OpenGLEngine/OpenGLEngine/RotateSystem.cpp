@@ -4,17 +4,15 @@ RotateSystem::RotateSystem()
 {
 	requireComponent<TransformComponent>();
 	requireComponent<RotateComponent>();
+	requireWriteAccess<TransformComponent>();
 }
 
 void RotateSystem::Update(float deltaTime)
 {
-	for (auto e : getEntities())
+	view<TransformComponent, RotateComponent>().parallelEach(Mix::DEFAULT_GRAIN_SIZE, [&](ECSEntity e, TransformComponent& transform, RotateComponent& rotate)
 	{
-		auto &rotate = e.getComponent<RotateComponent>();
-		auto &transform = e.getComponent<TransformComponent>();
-
 		transform.eulerAngles.x += rotate.xRot * deltaTime;
 		transform.eulerAngles.y += rotate.yRot * deltaTime;
 		transform.eulerAngles.z += rotate.zRot * deltaTime;
-	}
+	});
 }
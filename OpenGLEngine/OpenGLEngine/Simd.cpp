@@ -0,0 +1,62 @@
+#include "Simd.h"
+#if defined(_MSC_VER) && defined(REALITY_X86)
+#include <intrin.h>
+#endif
+
+namespace Reality
+{
+	namespace
+	{
+		SimdLevel DetectSimdLevel()
+		{
+#ifdef REALITY_X86
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			const int maxLeaf = info[0];
+			__cpuid(info, 1);
+			const bool sse = (info[3] & (1 << 25)) != 0;
+			// AVX also needs the OS to save the upper halves of the registers
+			const bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+			bool avx2 = false;
+			if (avx && maxLeaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				avx2 = (info[1] & (1 << 5)) != 0;
+			}
+#else
+			const bool sse = __builtin_cpu_supports("sse");
+			const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+			if (avx2)
+			{
+				return SimdLevel::Avx2;
+			}
+			if (sse)
+			{
+				return SimdLevel::Sse;
+			}
+#endif
+			return SimdLevel::Scalar;
+		}
+	}
+
+	SimdLevel GetSupportedSimdLevel()
+	{
+		static const SimdLevel level = DetectSimdLevel();
+		return level;
+	}
+
+	const char* GetSimdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::Avx2:
+			return "avx2";
+		case SimdLevel::Sse:
+			return "sse";
+		default:
+			return "scalar";
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// x86 intrinsics, with the per-function target attributes GCC and Clang need to use wider ones than the build's
+// baseline. MSVC compiles any intrinsic anywhere.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define REALITY_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(REALITY_X86) && (defined(__GNUC__) || defined(__clang__))
+#define REALITY_TARGET_SSE __attribute__((target("sse")))
+#define REALITY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define REALITY_TARGET_SSE
+#define REALITY_TARGET_AVX2
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace Reality
+{
+	enum class SimdLevel
+	{
+		Scalar,
+		Sse,	// 4 floats at a time
+		Avx2	// 8 floats at a time
+	};
+
+	// Widest level the CPU, and the OS for AVX, supports. Kernels pick their code path with it at runtime.
+	SimdLevel GetSupportedSimdLevel();
+	// "scalar", "sse" or "avx2"
+	const char* GetSimdLevelName(SimdLevel level);
+
+	/*
+		Base of the classes that have a kernel for each SIMD level and pick one at runtime. Starts at the widest level
+		the CPU supports.
+
+		The kernels are the static functions Scalar, Sse and Avx2 of a struct, all taking the same arguments. Sse and
+		Avx2 only have to exist on x86, everywhere else the scalar one runs.
+	*/
+	class SimdDispatcher
+	{
+	public:
+		// Levels the CPU doesn't support fall back to the widest one it does
+		void SetSimdLevel(SimdLevel level) { simdLevel = std::min(level, GetSupportedSimdLevel()); }
+		SimdLevel GetSimdLevel() const { return simdLevel; }
+
+	protected:
+		// Calls the kernel of the current level
+		template<typename Kernels, typename... Args>
+		auto RunKernel(Args&&... args) const -> decltype(Kernels::Scalar(std::forward<Args>(args)...))
+		{
+			switch (simdLevel)
+			{
+#ifdef REALITY_X86
+			case SimdLevel::Avx2:
+				return Kernels::Avx2(std::forward<Args>(args)...);
+			case SimdLevel::Sse:
+				return Kernels::Sse(std::forward<Args>(args)...);
+#endif
+			default:
+				return Kernels::Scalar(std::forward<Args>(args)...);
+			}
+		}
+
+	private:
+		SimdLevel simdLevel = GetSupportedSimdLevel();
+	};
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "ECSConfig.h"
+#include "ParticleComponent.h"
+#include <cstdint>
+
+namespace Reality
+{
+	// Takes the place of the ParticleComponent of a particle that is asleep, so nothing that works on particles sees
+	// the entity until ParticleSleepSystem puts the particle back
+	struct SleepingParticleComponent
+	{
+		SleepingParticleComponent(ParticleComponent _particle = ParticleComponent(), uint32_t _group = 0) :
+			particle(_particle), group(_group) {}
+		ParticleComponent particle;
+		// The particles that fell asleep together, and wake together
+		uint32_t group;
+	};
+}
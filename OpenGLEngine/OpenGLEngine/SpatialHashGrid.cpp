@@ -0,0 +1,121 @@
+#include "SpatialHashGrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Reality
+{
+	namespace
+	{
+		// The neighbours that come after a cell in z, y, x order
+		const int forwardNeighbours[13][3] = {
+			{ 1, 0, 0 },
+			{ -1, 1, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+			{ -1, -1, 1 }, { 0, -1, 1 }, { 1, -1, 1 },
+			{ -1, 0, 1 }, { 0, 0, 1 }, { 1, 0, 1 },
+			{ -1, 1, 1 }, { 0, 1, 1 }, { 1, 1, 1 }
+		};
+	}
+
+	void SpatialHashGrid::Update(const std::vector<BroadphaseSphere>& spheres)
+	{
+		const auto count = (uint32_t)spheres.size();
+
+		float maxRadius = 0;
+		for (const auto& sphere : spheres)
+		{
+			maxRadius = std::max(maxRadius, sphere.radius);
+		}
+		cellSize = maxRadius > 0 ? 2 * maxRadius : 1;
+		const float inverseCellSize = 1 / cellSize;
+
+		// About two slots per sphere keeps collisions between different cells rare
+		uint32_t tableSize = 1;
+		while (tableSize < 2 * count)
+		{
+			tableSize *= 2;
+		}
+		tableMask = tableSize - 1;
+
+		cells.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const auto& position = spheres[i].position;
+			cells[i] = Cell{ (int)std::floor(position.x * inverseCellSize),
+				(int)std::floor(position.y * inverseCellSize),
+				(int)std::floor(position.z * inverseCellSize) };
+		}
+
+		// Counting sort by slot: count, turn the counts into slot ends, then fill each slot from the back
+		slotStart.assign(tableSize + 1, 0);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			slotStart[Hash(cells[i])]++;
+		}
+		uint32_t end = 0;
+		for (uint32_t slot = 0; slot <= tableSize; slot++)
+		{
+			end += slotStart[slot];
+			slotStart[slot] = end;
+		}
+		entries.resize(count);
+		for (uint32_t i = count; i-- > 0;)
+		{
+			entries[--slotStart[Hash(cells[i])]] = Entry{ spheres[i].position, spheres[i].radius, cells[i], i };
+		}
+	}
+
+	void SpatialHashGrid::FindPairs(std::vector<BroadphasePair>& pairs) const
+	{
+		const auto first = pairs.size();
+		const auto count = (uint32_t)entries.size();
+
+		// Walking the entries in slot order keeps the spheres of a cell and their neighbours' slots close together
+		for (uint32_t k = 0; k < count; k++)
+		{
+			const auto& entry = entries[k];
+			const auto slot = Hash(entry.cell);
+
+			// Spheres in the same cell come later in the same slot
+			for (auto other = k + 1; other < slotStart[slot + 1]; other++)
+			{
+				if (entries[other].cell == entry.cell)
+				{
+					AddPair(entry, entries[other], pairs);
+				}
+			}
+
+			// Spheres in the neighbouring cells ahead, comparing the cells skips spheres that only share the slot
+			for (const auto& offset : forwardNeighbours)
+			{
+				const Cell neighbour{ entry.cell.x + offset[0], entry.cell.y + offset[1], entry.cell.z + offset[2] };
+				const auto neighbourSlot = Hash(neighbour);
+				for (auto other = slotStart[neighbourSlot]; other < slotStart[neighbourSlot + 1]; other++)
+				{
+					if (entries[other].cell == neighbour)
+					{
+						AddPair(entry, entries[other], pairs);
+					}
+				}
+			}
+		}
+
+		// Same order as the brute force loops, so switching broadphases doesn't change the contact order
+		std::sort(pairs.begin() + first, pairs.end());
+	}
+
+	void SpatialHashGrid::AddPair(const Entry& a, const Entry& b, std::vector<BroadphasePair>& pairs) const
+	{
+		// Only pairs whose bounding boxes overlap
+		const auto delta = glm::abs(a.position - b.position);
+		const auto radii = a.radius + b.radius;
+		if (delta.x < radii && delta.y < radii && delta.z < radii)
+		{
+			pairs.emplace_back(std::min(a.index, b.index), std::max(a.index, b.index));
+		}
+	}
+
+	uint32_t SpatialHashGrid::Hash(const Cell& cell) const
+	{
+		return ((uint32_t)cell.x * 73856093u ^ (uint32_t)cell.y * 19349663u ^ (uint32_t)cell.z * 83492791u) & tableMask;
+	}
+}
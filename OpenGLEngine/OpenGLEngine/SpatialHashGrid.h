@@ -0,0 +1,56 @@
+#pragma once
+#include "SphereBroadphase.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Broadphase that puts every sphere in the cell of a uniform grid that holds its center. The cells are as wide as
+		the largest sphere's diameter, so two spheres can only touch if their cells are neighbours, and each sphere only
+		has to be checked against its own cell and the 13 neighbours "ahead" of it (the other 13 check it in turn).
+
+		The grid isn't stored as such: cells are hashed into a flat table that is rebuilt with a counting sort each step,
+		so building doesn't allocate once the vectors have grown and the cost is linear in the number of spheres.
+	*/
+	class SpatialHashGrid : public SphereBroadphase
+	{
+	public:
+		// Rebuilds the grid from the spheres, copying what it needs
+		void Update(const std::vector<BroadphaseSphere>& spheres) override;
+
+		void FindPairs(std::vector<BroadphasePair>& pairs) const override;
+
+		float GetCellSize() const { return cellSize; }
+
+	private:
+		struct Cell
+		{
+			int x;
+			int y;
+			int z;
+			bool operator==(const Cell& other) const { return x == other.x && y == other.y && z == other.z; }
+		};
+
+		// A sphere as stored in the table, everything the pair tests need is in one place
+		struct Entry
+		{
+			Vector3 position;
+			float radius;
+			Cell cell;
+			uint32_t index;
+		};
+
+		void AddPair(const Entry& a, const Entry& b, std::vector<BroadphasePair>& pairs) const;
+		uint32_t Hash(const Cell& cell) const;
+
+		float cellSize = 1;
+		uint32_t tableMask = 0;
+
+		// Cell of each sphere, index = sphere index
+		std::vector<Cell> cells;
+		// Spheres sorted by table slot, the spheres of slot s are in [slotStart[s], slotStart[s + 1])
+		std::vector<Entry> entries;
+		std::vector<uint32_t> slotStart;
+	};
+}
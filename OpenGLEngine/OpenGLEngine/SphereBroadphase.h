@@ -0,0 +1,74 @@
+#pragma once
+#include "ECSConfig.h"
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace Reality
+{
+	// A sphere handed to a broadphase, pairs refer to spheres by their index in the list.
+	// The id has to stay the same from step to step for the same body (e.g. the entity index).
+	struct BroadphaseSphere
+	{
+		BroadphaseSphere(Vector3 _position = Vector3(0, 0, 0), float _radius = 1, uint32_t _id = 0) :
+			position(_position), radius(_radius), id(_id) {}
+		Vector3 position;
+		float radius;
+		uint32_t id;
+	};
+
+	// Distance along the ray to where it enters the sphere, 0 if it starts inside. direction has to be normalized.
+	inline bool RayCastSphere(const BroadphaseSphere& sphere, const Vector3& origin, const Vector3& direction, float maxDistance, float& distance)
+	{
+		const auto offset = origin - sphere.position;
+		const float b = glm::dot(offset, direction);
+		const float c = glm::dot(offset, offset) - sphere.radius * sphere.radius;
+		// Starts outside and points away
+		if (c > 0 && b > 0)
+		{
+			return false;
+		}
+		const float discriminant = b * b - c;
+		if (discriminant < 0)
+		{
+			return false;
+		}
+		distance = std::max(-b - std::sqrt(discriminant), 0.0f);
+		return distance <= maxDistance;
+	}
+
+	// Two spheres whose bounds overlap, a < b
+	struct BroadphasePair
+	{
+		BroadphasePair(unsigned int _a = 0, unsigned int _b = 0) : a(_a), b(_b) {}
+		unsigned int a;
+		unsigned int b;
+	};
+
+	inline bool operator<(const BroadphasePair& lhs, const BroadphasePair& rhs)
+	{
+		return lhs.a < rhs.a || (lhs.a == rhs.a && lhs.b < rhs.b);
+	}
+
+	enum class BroadphaseMode
+	{
+		BruteForce,		// every pair goes to the narrowphase, O(n^2)
+		SpatialHashGrid,	// uniform grid hashed into a flat table, about O(n)
+		SweepAndPrune,	// sorted bounds kept from step to step, cheapest when bodies move a little each step
+		AabbTree		// dynamic bounding volume tree, copes with spheres of very different sizes
+	};
+
+	// Finds the pairs of spheres that may touch, implementations can keep what they learn from one step to the next
+	class SphereBroadphase
+	{
+	public:
+		virtual ~SphereBroadphase() {}
+
+		// Takes this step's spheres
+		virtual void Update(const std::vector<BroadphaseSphere>& spheres) = 0;
+
+		// Appends the pairs of the last update whose bounding boxes overlap to pairs, sorted
+		virtual void FindPairs(std::vector<BroadphasePair>& pairs) const = 0;
+	};
+}
@@ -1,5 +1,9 @@
 #include "SphereContactGeneratorSystem.h"
-#include "ParticleContactComponent.h"
+#include "ParticleContact.h"
+#include "SpatialHashGrid.h"
+#include "SweepAndPrune.h"
+#include "AabbTreeBroadphase.h"
+#include "SleepingParticleComponent.h"
 
 
 namespace Reality
@@ -9,95 +13,212 @@ namespace Reality
 		requireComponent<SphereComponent>();
 		requireComponent<ParticleComponent>();
 		requireComponent<TransformComponent>();
+		requireReadAccess<SleepingParticleComponent>();
+		requireMainThread();
 	}
 
 
 	void SphereContactGeneratorSystem::Update(float deltaTime)
 	{
+		auto& events = getWorld().getEventManager();
+
+		// The dummy stands in for the walls, it only exists once the command buffer has been flushed
+		bool hasDummy = dummyCreated;
 		if (!dummyCreated)
 		{
-			dummy = getWorld().createEntity();
+			getWorld().getCommandBuffer().createEntity(&dummy);
 			dummyCreated = true;
 		}
-		auto entities = getEntities();
-		for (int i = 0; i < entities.size(); i++)
+		// Gather the spheres once so the pair tests run over packed data. Sleeping particles come after the awake ones,
+		// they still stop awake spheres but don't collide with each other or with the walls.
+		spheres.clear();
+		entities.clear();
+		for (auto e : getEntities())
 		{
-			auto& transform1 = entities[i].getComponent<TransformComponent>();
-			auto& sphere1 = entities[i].getComponent<SphereComponent>();
-			auto& particle1 = entities[i].getComponent<ParticleComponent>();
-			bool collided = false;
-			// Check collisions with other spheres
-			if (entities.size() > 1)
+			spheres.emplace_back(e.getComponent<TransformComponent>().position, e.getComponent<SphereComponent>().radius, e.getIndex());
+			entities.push_back(e);
+		}
+		const auto awakeCount = (unsigned int)entities.size();
+		getWorld().view<TransformComponent, SphereComponent, SleepingParticleComponent>().each([this](ECSEntity e, TransformComponent& transform, SphereComponent& sphere, SleepingParticleComponent&)
+		{
+			spheres.emplace_back(transform.position, sphere.radius, e.getIndex());
+			entities.push_back(e);
+		});
+
+		// Broadphase, the pairs come out sorted so the contacts are emitted in the same order as with brute force
+		if (broadphase != broadphaseImplMode)
+		{
+			tree = nullptr;
+			switch (broadphase)
+			{
+			case BroadphaseMode::SpatialHashGrid:
+				broadphaseImpl = std::make_unique<SpatialHashGrid>();
+				break;
+			case BroadphaseMode::SweepAndPrune:
+				broadphaseImpl = std::make_unique<SweepAndPrune>();
+				break;
+			case BroadphaseMode::AabbTree:
+			{
+				auto aabbTree = std::make_unique<AabbTreeBroadphase>();
+				tree = aabbTree.get();
+				broadphaseImpl = std::move(aabbTree);
+				break;
+			}
+			default:
+				broadphaseImpl = nullptr;
+				break;
+			}
+			broadphaseImplMode = broadphase;
+		}
+		pairs.clear();
+		if (broadphaseImpl)
+		{
+			broadphaseImpl->Update(spheres);
+			broadphaseImpl->FindPairs(pairs);
+		}
+		else
+		{
+			for (unsigned int i = 0; i < spheres.size(); i++)
 			{
-				if (i < entities.size() - 1)
+				for (unsigned int j = i + 1; j < spheres.size(); j++)
 				{
-					for (int j = i + 1; j < entities.size(); j++)
-					{
-						auto& transform2 = entities[j].getComponent<TransformComponent>();
-						auto& sphere2 = entities[j].getComponent<SphereComponent>();
-						auto& particle2 = entities[j].getComponent<ParticleComponent>();
-
-						if (glm::length(transform1.position - transform2.position)
-							< sphere1.radius + sphere2.radius)
-						{
-							float penetration = sphere1.radius + sphere2.radius - 
-								glm::length(transform1.position - transform2.position);
-							ECSEntity e = getWorld().createEntity();
-							Vector3 normal = glm::normalize(transform1.position - transform2.position);
-
-							getWorld().data.renderUtil->DrawLine(transform1.position - sphere1.radius * normal,
-								transform1.position - sphere1.radius * normal + penetration * normal, Color(0, 0, 1));
-
-							e.addComponent<ParticleContactComponent>(entities[i],
-								entities[j],
-								1.0f,
-								normal,
-								penetration);
-							collided = true;
-						}
-					}
+					pairs.emplace_back(i, j);
 				}
 			}
+		}
+
+		// The pairs are sorted by their first sphere, so the ones between two sleeping spheres are at the end
+		pairs.erase(std::lower_bound(pairs.begin(), pairs.end(), BroadphasePair(awakeCount, 0)), pairs.end());
+
+		// Narrowphase, the contacts come out in the order of the pairs
+		contacts.clear();
+		narrowphase.Collide(spheres, pairs, contacts);
+
+		unsigned int contact = 0;
+		for (unsigned int i = 0; i < entities.size(); i++)
+		{
+			const auto& sphere = spheres[i];
+			if (i >= awakeCount)
+			{
+				getWorld().data.renderUtil->DrawSphere(sphere.position, sphere.radius, Color(0.5f, 0.5f, 0.5f, 1));
+				continue;
+			}
+			bool collided = false;
+			// Collisions with other spheres
+			for (; contact < contacts.size() && contacts[contact].a == i; contact++)
+			{
+				EmitSphereContact(contacts[contact]);
+				collided = true;
+			}
 			// Check collision with Hardcoded walls
-			if (abs(transform1.position.x) >= 14)
+			if (hasDummy && abs(sphere.position.x) >= 14)
 			{
-				float penetration = abs(transform1.position.x) - 14;
-				ECSEntity e = getWorld().createEntity();
-				Vector3 normal = (transform1.position.x > 0 ? -1.0f : 1.0f) * Vector3(1, 0, 0);
-				e.addComponent<ParticleContactComponent>(entities[i],
+				float penetration = abs(sphere.position.x) - 14;
+				Vector3 normal = (sphere.position.x > 0 ? -1.0f : 1.0f) * Vector3(1, 0, 0);
+				events.emitEvent<ParticleContact>(entities[i],
 					dummy,
 					1.0f,
 					normal,
-					penetration);
+					penetration,
+					WallContactFeature + (sphere.position.x > 0 ? 1 : 0));
 				collided = true;
 			}
-			if (abs(transform1.position.y - 20) >= 14)
+			if (hasDummy && abs(sphere.position.y - 20) >= 14)
 			{
-				float penetration = abs(transform1.position.y - 20) - 14;
-				ECSEntity e = getWorld().createEntity();
-				Vector3 normal = ((transform1.position.y - 20) > 0 ? -1.0f : 1.0f) * Vector3(0, 1, 0);
-				e.addComponent<ParticleContactComponent>(entities[i],
+				float penetration = abs(sphere.position.y - 20) - 14;
+				Vector3 normal = ((sphere.position.y - 20) > 0 ? -1.0f : 1.0f) * Vector3(0, 1, 0);
+				events.emitEvent<ParticleContact>(entities[i],
 					dummy,
 					1.0f,
 					normal,
-					penetration);
+					penetration,
+					WallContactFeature + 2 + (sphere.position.y - 20 > 0 ? 1 : 0));
 				collided = true;
 			}
-			if (abs(transform1.position.z) >= 14)
+			if (hasDummy && abs(sphere.position.z) >= 14)
 			{
-				float penetration = abs(transform1.position.z) - 14;
-				ECSEntity e = getWorld().createEntity();
-				Vector3 normal = (transform1.position.z > 0 ? -1.0f : 1.0f) * Vector3(0, 0, 1);
-				e.addComponent<ParticleContactComponent>(entities[i],
+				float penetration = abs(sphere.position.z) - 14;
+				Vector3 normal = (sphere.position.z > 0 ? -1.0f : 1.0f) * Vector3(0, 0, 1);
+				events.emitEvent<ParticleContact>(entities[i],
 					dummy,
 					1.0f,
 					normal,
-					penetration);
+					penetration,
+					WallContactFeature + 4 + (sphere.position.z > 0 ? 1 : 0));
 				collided = true;
 			}
 			Color col = collided ? Color(1, 0, 0, 1) : Color(0, 1, 0, 1);
-			getWorld().data.renderUtil->DrawSphere(transform1.position, sphere1.radius, col);
+			getWorld().data.renderUtil->DrawSphere(sphere.position, sphere.radius, col);
 		}
 		getWorld().data.renderUtil->DrawCube(Vector3(0, 20, 0), Vector3(30, 30, 30));
 	}
+
+	void SphereContactGeneratorSystem::EmitSphereContact(const SphereContactRecord& contact)
+	{
+		const auto& sphere1 = spheres[contact.a];
+		const auto& normal = contact.normal;
+		const auto penetration = contact.penetration;
+
+		getWorld().data.renderUtil->DrawLine(sphere1.position - sphere1.radius * normal,
+			sphere1.position - sphere1.radius * normal + penetration * normal, Color(0, 0, 1));
+
+		getWorld().getEventManager().emitEvent<ParticleContact>(entities[contact.a],
+			entities[contact.b],
+			1.0f,
+			normal,
+			penetration);
+	}
+
+	void SphereContactGeneratorSystem::QueryOverlaps(const Aabb& box, std::vector<ECSEntity>& result) const
+	{
+		auto& entityManager = getWorld().getEntityManager();
+		if (tree)
+		{
+			std::vector<unsigned int> found;
+			tree->QueryOverlaps(box, found);
+			for (auto sphere : found)
+			{
+				result.push_back(entityManager.getEntity(spheres[sphere].id));
+			}
+			return;
+		}
+
+		for (const auto& sphere : spheres)
+		{
+			if (box.Overlaps(Aabb(sphere.position - Vector3(sphere.radius), sphere.position + Vector3(sphere.radius))))
+			{
+				result.push_back(entityManager.getEntity(sphere.id));
+			}
+		}
+	}
+
+	bool SphereContactGeneratorSystem::RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, ECSEntity& hit, float& distance) const
+	{
+		bool found = false;
+		unsigned int closest = 0;
+		if (tree)
+		{
+			found = tree->RayCast(origin, direction, maxDistance, closest, distance);
+		}
+		else
+		{
+			for (unsigned int i = 0; i < spheres.size(); i++)
+			{
+				float t;
+				if (RayCastSphere(spheres[i], origin, direction, maxDistance, t))
+				{
+					maxDistance = t;
+					distance = t;
+					closest = i;
+					found = true;
+				}
+			}
+		}
+
+		if (found)
+		{
+			hit = getWorld().getEntityManager().getEntity(spheres[closest].id);
+		}
+		return found;
+	}
 }
@@ -3,17 +3,47 @@
 #include "SphereComponent.h"
 #include "ParticleComponent.h"
 #include "TransformComponent.h"
+#include "SphereBroadphase.h"
+#include "DynamicAabbTree.h"
+#include "SphereNarrowphase.h"
+#include <vector>
+#include <memory>
 
 namespace Reality
 {
+	class AabbTreeBroadphase;
+
 	class SphereContactGeneratorSystem : public ECSSystem
 	{
 	public:
 		SphereContactGeneratorSystem();
 		void Update(float deltaTime);
+		// Which pairs of spheres get tested, can be changed between updates. Brute force is there to compare against.
+		// The grid is the fastest for spheres of about one size, which is all the demo scenes have. Scenes with a few
+		// spheres much bigger than the rest should switch to the AABB tree, the grid cells get sized for the big ones.
+		BroadphaseMode broadphase = BroadphaseMode::SpatialHashGrid;
+		SphereNarrowphase narrowphase;
+
+		// Spheres whose bounding boxes overlap the box, as of the last update. Uses the AABB tree when that is the
+		// broadphase, otherwise it checks every sphere.
+		void QueryOverlaps(const Aabb& box, std::vector<ECSEntity>& result) const;
+		// Closest sphere the ray hits within maxDistance, as of the last update. direction has to be normalized.
+		bool RayCast(const Vector3& origin, const Vector3& direction, float maxDistance, ECSEntity& hit, float& distance) const;
 	private:
+		// Draws and emits a contact between two spheres, a and b are indices into the entities
+		void EmitSphereContact(const SphereContactRecord& contact);
 		bool dummyCreated = false;
 		ECSEntity dummy;
+		// This frame's spheres, the awake ones first
+		std::vector<ECSEntity> entities;
+		// Positions and radii of this frame's spheres, same order as the entities
+		std::vector<BroadphaseSphere> spheres;
+		std::vector<BroadphasePair> pairs;
+		std::vector<SphereContactRecord> contacts;
+		// Created for the current mode, null for brute force
+		std::unique_ptr<SphereBroadphase> broadphaseImpl;
+		BroadphaseMode broadphaseImplMode = BroadphaseMode::BruteForce;
+		// broadphaseImpl when it is the AABB tree, for the queries
+		AabbTreeBroadphase* tree = nullptr;
 	};
 }
-
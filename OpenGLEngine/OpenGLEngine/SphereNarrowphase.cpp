@@ -0,0 +1,22 @@
+#include "SphereNarrowphase.h"
+#include <cmath>
+
+namespace Reality
+{
+	void SphereNarrowphase::Collide(const std::vector<BroadphaseSphere>& spheres, const std::vector<BroadphasePair>& pairs, std::vector<SphereContactRecord>& contacts)
+	{
+		for (const auto& pair : pairs)
+		{
+			const auto& a = spheres[pair.a];
+			const auto& b = spheres[pair.b];
+			const auto delta = a.position - b.position;
+			const float radii = a.radius + b.radius;
+			const float distanceSquared = glm::dot(delta, delta);
+			if (distanceSquared < radii * radii)
+			{
+				const float distance = std::sqrt(distanceSquared);
+				contacts.emplace_back(pair.a, pair.b, delta * (1 / distance), radii - distance);
+			}
+		}
+	}
+}
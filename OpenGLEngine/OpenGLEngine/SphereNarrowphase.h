@@ -0,0 +1,31 @@
+#pragma once
+#include "SphereBroadphase.h"
+#include <vector>
+
+namespace Reality
+{
+	// Two spheres that intersect, the normal points from b to a
+	struct SphereContactRecord
+	{
+		SphereContactRecord(unsigned int _a = 0, unsigned int _b = 0, Vector3 _normal = Vector3(0, 0, 0), float _penetration = 0) :
+			a(_a), b(_b), normal(_normal), penetration(_penetration) {}
+		unsigned int a;
+		unsigned int b;
+		Vector3 normal;
+		float penetration;
+	};
+
+	/*
+		Sphere-sphere tests for the broadphase's candidate pairs. Pairs that don't touch are rejected on the squared
+		distance, the square root is only taken for a hit and gives both the normal and the penetration.
+
+		The tests are scalar: gathering the pairs' spheres costs more than the tests themselves, so testing them 4 or 8
+		at a time didn't make the narrowphase faster.
+	*/
+	class SphereNarrowphase
+	{
+	public:
+		// Appends a record for every pair whose spheres intersect, in the order of the pairs
+		void Collide(const std::vector<BroadphaseSphere>& spheres, const std::vector<BroadphasePair>& pairs, std::vector<SphereContactRecord>& contacts);
+	};
+}
@@ -0,0 +1,200 @@
+#include "SpringNetwork.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace Reality
+{
+	namespace
+	{
+		struct SpringArrays
+		{
+			const float* px;
+			const float* py;
+			const float* pz;
+			const uint32_t* a;
+			const uint32_t* b;
+			const float* restLengths;
+			const float* springConstants;
+			const float* minStretches;
+			float* fx;
+			float* fy;
+			float* fz;
+			float* stretches;
+		};
+
+		// Same operations in the same order as the wide kernels, one spring at a time
+		void ComputeForcesScalar(const SpringArrays& s, uint32_t begin, uint32_t end)
+		{
+			for (auto i = begin; i < end; i++)
+			{
+				const float dx = s.px[s.a[i]] - s.px[s.b[i]];
+				const float dy = s.py[s.a[i]] - s.py[s.b[i]];
+				const float dz = s.pz[s.a[i]] - s.pz[s.b[i]];
+				const float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+				const float stretch = std::max(length - s.restLengths[i], s.minStretches[i]);
+				// Springs whose ends are in the same place have no direction to push along
+				const float scale = length > 0 ? s.springConstants[i] * stretch / length : 0.0f;
+				s.fx[i] = dx * scale;
+				s.fy[i] = dy * scale;
+				s.fz[i] = dz * scale;
+				s.stretches[i] = stretch;
+			}
+		}
+
+#ifdef REALITY_X86
+		REALITY_TARGET_SSE uint32_t ComputeForcesSse(const SpringArrays& s, uint32_t begin, uint32_t end)
+		{
+			const auto zero = _mm_setzero_ps();
+			auto i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				const uint32_t* a = s.a + i;
+				const uint32_t* b = s.b + i;
+				const auto dx = _mm_sub_ps(_mm_setr_ps(s.px[a[0]], s.px[a[1]], s.px[a[2]], s.px[a[3]]),
+					_mm_setr_ps(s.px[b[0]], s.px[b[1]], s.px[b[2]], s.px[b[3]]));
+				const auto dy = _mm_sub_ps(_mm_setr_ps(s.py[a[0]], s.py[a[1]], s.py[a[2]], s.py[a[3]]),
+					_mm_setr_ps(s.py[b[0]], s.py[b[1]], s.py[b[2]], s.py[b[3]]));
+				const auto dz = _mm_sub_ps(_mm_setr_ps(s.pz[a[0]], s.pz[a[1]], s.pz[a[2]], s.pz[a[3]]),
+					_mm_setr_ps(s.pz[b[0]], s.pz[b[1]], s.pz[b[2]], s.pz[b[3]]));
+				const auto length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+				const auto stretch = _mm_max_ps(_mm_sub_ps(length, _mm_loadu_ps(s.restLengths + i)), _mm_loadu_ps(s.minStretches + i));
+				const auto scale = _mm_and_ps(_mm_cmpgt_ps(length, zero),
+					_mm_div_ps(_mm_mul_ps(_mm_loadu_ps(s.springConstants + i), stretch), length));
+				_mm_storeu_ps(s.fx + i, _mm_mul_ps(dx, scale));
+				_mm_storeu_ps(s.fy + i, _mm_mul_ps(dy, scale));
+				_mm_storeu_ps(s.fz + i, _mm_mul_ps(dz, scale));
+				_mm_storeu_ps(s.stretches + i, stretch);
+			}
+			return i;
+		}
+
+		REALITY_TARGET_AVX2 uint32_t ComputeForcesAvx2(const SpringArrays& s, uint32_t begin, uint32_t end)
+		{
+			const auto zero = _mm256_setzero_ps();
+			auto i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				const auto a = _mm256_loadu_si256((const __m256i*)(s.a + i));
+				const auto b = _mm256_loadu_si256((const __m256i*)(s.b + i));
+				const auto dx = _mm256_sub_ps(_mm256_i32gather_ps(s.px, a, 4), _mm256_i32gather_ps(s.px, b, 4));
+				const auto dy = _mm256_sub_ps(_mm256_i32gather_ps(s.py, a, 4), _mm256_i32gather_ps(s.py, b, 4));
+				const auto dz = _mm256_sub_ps(_mm256_i32gather_ps(s.pz, a, 4), _mm256_i32gather_ps(s.pz, b, 4));
+				// No fused multiply-add, so the results match the other levels bit for bit
+				const auto length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+				const auto stretch = _mm256_max_ps(_mm256_sub_ps(length, _mm256_loadu_ps(s.restLengths + i)), _mm256_loadu_ps(s.minStretches + i));
+				const auto scale = _mm256_and_ps(_mm256_cmp_ps(length, zero, _CMP_GT_OQ),
+					_mm256_div_ps(_mm256_mul_ps(_mm256_loadu_ps(s.springConstants + i), stretch), length));
+				_mm256_storeu_ps(s.fx + i, _mm256_mul_ps(dx, scale));
+				_mm256_storeu_ps(s.fy + i, _mm256_mul_ps(dy, scale));
+				_mm256_storeu_ps(s.fz + i, _mm256_mul_ps(dz, scale));
+				_mm256_storeu_ps(s.stretches + i, stretch);
+			}
+			return i;
+		}
+#endif
+
+		// The kernels for SimdDispatcher, the wide ones stop at the last whole batch and the scalar one does the rest
+		struct ForceKernels
+		{
+			static void Scalar(const SpringArrays& s, uint32_t begin, uint32_t end)
+			{
+				ComputeForcesScalar(s, begin, end);
+			}
+#ifdef REALITY_X86
+			static void Sse(const SpringArrays& s, uint32_t begin, uint32_t end)
+			{
+				ComputeForcesScalar(s, ComputeForcesSse(s, begin, end), end);
+			}
+			static void Avx2(const SpringArrays& s, uint32_t begin, uint32_t end)
+			{
+				ComputeForcesScalar(s, ComputeForcesAvx2(s, begin, end), end);
+			}
+#endif
+		};
+	}
+
+	void SpringNetwork::Reset(uint32_t nodeCount)
+	{
+		px.assign(nodeCount, 0.0f);
+		py.assign(nodeCount, 0.0f);
+		pz.assign(nodeCount, 0.0f);
+		a.clear();
+		b.clear();
+		restLengths.clear();
+		springConstants.clear();
+		minStretches.clear();
+		flags.clear();
+	}
+
+	void SpringNetwork::AddSpring(uint32_t nodeA, uint32_t nodeB, float restLength, float springConstant, uint32_t springFlags)
+	{
+		a.push_back(nodeA);
+		b.push_back(nodeB);
+		restLengths.push_back(restLength);
+		springConstants.push_back(springConstant);
+		minStretches.push_back((springFlags & TensionOnly) ? 0.0f : -std::numeric_limits<float>::infinity());
+		flags.push_back(springFlags);
+	}
+
+	void SpringNetwork::Build()
+	{
+		const auto springCount = GetSpringCount();
+		fx.assign(springCount, 0.0f);
+		fy.assign(springCount, 0.0f);
+		fz.assign(springCount, 0.0f);
+		stretches.assign(springCount, 0.0f);
+
+		// Counting sort of the pushed ends by node, the springs of a node stay in spring order
+		nodeStart.assign(GetNodeCount() + 1, 0);
+		for (uint32_t i = 0; i < springCount; i++)
+		{
+			nodeStart[a[i]] += (flags[i] & PushA) ? 1 : 0;
+			nodeStart[b[i]] += (flags[i] & PushB) ? 1 : 0;
+		}
+		uint32_t end = 0;
+		for (auto& start : nodeStart)
+		{
+			end += start;
+			start = end;
+		}
+		nodeSprings.resize(end);
+		for (auto i = springCount; i-- > 0;)
+		{
+			if (flags[i] & PushB)
+			{
+				nodeSprings[--nodeStart[b[i]]] = i << 1;
+			}
+			if (flags[i] & PushA)
+			{
+				nodeSprings[--nodeStart[a[i]]] = i << 1 | 1;
+			}
+		}
+	}
+
+	void SpringNetwork::ComputeForces(uint32_t begin, uint32_t end)
+	{
+		const SpringArrays arrays{ px.data(), py.data(), pz.data(), a.data(), b.data(), restLengths.data(), springConstants.data(),
+			minStretches.data(), fx.data(), fy.data(), fz.data(), stretches.data() };
+		RunKernel<ForceKernels>(arrays, begin, end);
+	}
+
+	Vector3 SpringNetwork::GetNodeForce(uint32_t node) const
+	{
+		Vector3 force(0, 0, 0);
+		for (auto k = nodeStart[node]; k < nodeStart[node + 1]; k++)
+		{
+			const auto spring = nodeSprings[k] >> 1;
+			const Vector3 springForce(fx[spring], fy[spring], fz[spring]);
+			if (nodeSprings[k] & 1)
+			{
+				force -= springForce;
+			}
+			else
+			{
+				force += springForce;
+			}
+		}
+		return force;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "ECSConfig.h"
+#include "Simd.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Springs between nodes, kept as a flat table so their forces can be taken several springs at a time.
+
+		Each spring pulls its two ends towards its rest length with a force springConstant * stretch, along the line
+		between them. Ends without their push flag are only anchors: they pull the other end but get no force, like the
+		anchor of a fixed spring or the top of a bungee. Tension only springs (bungees) have no force while they are
+		shorter than their rest length.
+
+		Build also makes the springs of each node a compressed row (CSR) list, so the force on a node is the sum over
+		its own list. Every node is written by one thread only, so the sums need no atomics and don't depend on the
+		number of threads. All levels do the same operations in the same order, so they give the same results as the
+		scalar one.
+	*/
+	class SpringNetwork : public SimdDispatcher
+	{
+	public:
+		enum SpringFlags : uint32_t
+		{
+			PushA = 1,
+			PushB = 2,
+			TensionOnly = 4
+		};
+
+		void Reset(uint32_t nodeCount);
+		// Springs are numbered in the order they are added
+		void AddSpring(uint32_t nodeA, uint32_t nodeB, float restLength, float springConstant, uint32_t springFlags);
+		// Makes the per node lists, call it after the last spring is added
+		void Build();
+
+		uint32_t GetNodeCount() const { return (uint32_t)px.size(); }
+		uint32_t GetSpringCount() const { return (uint32_t)a.size(); }
+
+		// Changing the constants keeps the lists
+		void SetConstants(uint32_t spring, float restLength, float springConstant)
+		{
+			restLengths[spring] = restLength;
+			springConstants[spring] = springConstant;
+		}
+		void SetPosition(uint32_t node, const Vector3& position)
+		{
+			px[node] = position.x;
+			py[node] = position.y;
+			pz[node] = position.z;
+		}
+		Vector3 GetPosition(uint32_t node) const { return Vector3(px[node], py[node], pz[node]); }
+		uint32_t GetA(uint32_t spring) const { return a[spring]; }
+		uint32_t GetB(uint32_t spring) const { return b[spring]; }
+		float GetRestLength(uint32_t spring) const { return restLengths[spring]; }
+		float GetSpringConstant(uint32_t spring) const { return springConstants[spring]; }
+		uint32_t GetFlags(uint32_t spring) const { return flags[spring]; }
+		// The springs that push node n are GetNodeSprings()[GetNodeStart()[n], GetNodeStart()[n + 1]), as
+		// spring << 1 | 1 where n is end a
+		const std::vector<uint32_t>& GetNodeStart() const { return nodeStart; }
+		const std::vector<uint32_t>& GetNodeSprings() const { return nodeSprings; }
+		// Whether any spring pushes the node
+		bool IsPushed(uint32_t node) const { return nodeStart[node] != nodeStart[node + 1]; }
+
+		// Takes the forces of springs [begin, end) from the node positions
+		void ComputeForces(uint32_t begin, uint32_t end);
+		// Length minus rest length of the spring at the last ComputeForces, 0 for slack bungees
+		float GetStretch(uint32_t spring) const { return stretches[spring]; }
+		// Sum of the forces of the node's springs, after ComputeForces for all of them
+		Vector3 GetNodeForce(uint32_t node) const;
+
+	private:
+		// Node positions
+		std::vector<float> px, py, pz;
+
+		// Spring table, index = spring
+		std::vector<uint32_t> a, b;
+		std::vector<float> restLengths;
+		std::vector<float> springConstants;
+		// -infinity, or 0 for tension only springs, the stretch is clamped to it
+		std::vector<float> minStretches;
+		std::vector<uint32_t> flags;
+		// Force on b, a gets the opposite one
+		std::vector<float> fx, fy, fz;
+		std::vector<float> stretches;
+
+		std::vector<uint32_t> nodeStart;
+		std::vector<uint32_t> nodeSprings;
+	};
+}
@@ -0,0 +1,199 @@
+#include "SpringNetworkSystem.h"
+#include "TransformComponent.h"
+#include "ParticleComponent.h"
+#include "PairedSpringComponent.h"
+#include "BungeeComponent.h"
+#include "FixedSpringComponent.h"
+#include <cmath>
+
+namespace Reality
+{
+	namespace
+	{
+		// Kinds of spring components in the graph
+		enum SpringKind : uint32_t
+		{
+			PairedSpringKind,
+			BungeeKind,
+			FixedSpringKind,
+			SpringKindCount
+		};
+	}
+
+	SpringNetworkSystem::SpringNetworkSystem()
+	{
+		requireReadAccess<PairedSpringComponent>();
+		requireReadAccess<BungeeComponent>();
+		requireReadAccess<FixedSpringComponent>();
+		requireReadAccess<TransformComponent>();
+		requireWriteAccess<ParticleComponent>();
+		requireMainThread();
+	}
+
+	void SpringNetworkSystem::Update(float deltaTime)
+	{
+		// The components are only walked when something could have changed them
+		const bool sync = graph.NeedsSync<PairedSpringComponent, BungeeComponent, FixedSpringComponent>(getWorld().getEntityManager());
+		if (sync && !SyncConstants())
+		{
+			Rebuild();
+		}
+
+		const bool implicit = implicitIntegration && deltaTime > 0;
+		if (implicit)
+		{
+			nodeInverseMasses.resize(network.GetNodeCount());
+			nodeVelocities.resize(network.GetNodeCount());
+		}
+
+		const auto grainSize = Mix::ThreadPool::alignToCacheLines(Mix::DEFAULT_GRAIN_SIZE);
+		getThreadPool().parallelFor(network.GetNodeCount(), grainSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (auto node = begin; node < end; node++)
+			{
+				// Ends that gained or lost their transform keep the old position for this step
+				if (sync)
+				{
+					graph.CheckTransform(node);
+				}
+				if (const auto* transform = graph.GetTransform(node))
+				{
+					network.SetPosition(node, transform->position);
+				}
+
+				if (implicit)
+				{
+					const auto* particle = graph.GetParticle(node);
+					nodeInverseMasses[node] = particle ? particle->inverseMass : 0.0f;
+					nodeVelocities[node] = particle ? particle->velocity : Vector3(0, 0, 0);
+				}
+			}
+		});
+
+		getThreadPool().parallelFor(network.GetSpringCount(), grainSize, [&](unsigned int begin, unsigned int end)
+		{
+			network.ComputeForces(begin, end);
+		});
+
+		if (implicit)
+		{
+			implicitSolver.Solve(network, nodeInverseMasses, nodeVelocities, deltaTime, getThreadPool());
+		}
+
+		getThreadPool().parallelFor(network.GetNodeCount(), grainSize, [&](unsigned int begin, unsigned int end)
+		{
+			for (auto node = begin; node < end; node++)
+			{
+				auto* particle = graph.GetParticle(node);
+				if (!network.IsPushed(node) || !particle)
+				{
+					continue;
+				}
+
+				if (implicit && particle->inverseMass > 0)
+				{
+					particle->AddForce(implicitSolver.GetVelocityChanges()[node] / (deltaTime * particle->inverseMass));
+				}
+				else
+				{
+					particle->AddForce(network.GetNodeForce(node));
+				}
+			}
+		});
+
+		if (drawSprings)
+		{
+			Draw();
+		}
+	}
+
+	bool SpringNetworkSystem::SyncConstants()
+	{
+		// The graph's edges are the springs
+		graph.BeginSync();
+		auto sync = [&](uint32_t kind, ECSEntity e, ECSEntity a, ECSEntity b, float restLength, float springConstant)
+		{
+			const auto spring = graph.FindEdge(kind, e, a, b);
+			if (spring != ComponentGraph::NoEdge)
+			{
+				network.SetConstants(spring, restLength, springConstant);
+			}
+		};
+
+		const auto grainSize = Mix::DEFAULT_GRAIN_SIZE;
+		view<PairedSpringComponent>().parallelEach(grainSize, [&](ECSEntity e, PairedSpringComponent& paired)
+		{
+			sync(PairedSpringKind, e, paired.entityA, paired.entityB, paired.restLength, paired.springConstant);
+		});
+		view<TransformComponent, BungeeComponent>().parallelEach(grainSize, [&](ECSEntity e, TransformComponent&, BungeeComponent& bungee)
+		{
+			sync(BungeeKind, e, bungee.entityA, bungee.entityB, bungee.restLength, bungee.springConstant);
+		});
+		// The fixed spring's own entity is the anchor
+		view<TransformComponent, FixedSpringComponent>().parallelEach(grainSize, [&](ECSEntity e, TransformComponent&, FixedSpringComponent& fixed)
+		{
+			sync(FixedSpringKind, e, fixed.entity, e, fixed.restLength, fixed.springConstant);
+		});
+		return graph.EndSync(getThreadPool());
+	}
+
+	void SpringNetworkSystem::Rebuild()
+	{
+		rebuildCount++;
+
+		struct NewSpring
+		{
+			float restLength;
+			float springConstant;
+			uint32_t flags;
+		};
+		std::vector<NewSpring> springs;
+		graph.Clear(SpringKindCount);
+		view<PairedSpringComponent>().each([&](ECSEntity e, PairedSpringComponent& paired)
+		{
+			graph.AddEdge(PairedSpringKind, e, paired.entityA, paired.entityB);
+			springs.push_back(NewSpring{ paired.restLength, paired.springConstant, SpringNetwork::PushA | SpringNetwork::PushB });
+		});
+		// Bungees only pull their second end, and like springs on fixed ones their entity needs a transform
+		view<TransformComponent, BungeeComponent>().each([&](ECSEntity e, TransformComponent&, BungeeComponent& bungee)
+		{
+			graph.AddEdge(BungeeKind, e, bungee.entityA, bungee.entityB);
+			springs.push_back(NewSpring{ bungee.restLength, bungee.springConstant, SpringNetwork::PushB | SpringNetwork::TensionOnly });
+		});
+		drawnCount = (uint32_t)springs.size();
+		view<TransformComponent, FixedSpringComponent>().each([&](ECSEntity e, TransformComponent&, FixedSpringComponent& fixed)
+		{
+			graph.AddEdge(FixedSpringKind, e, fixed.entity, e);
+			springs.push_back(NewSpring{ fixed.restLength, fixed.springConstant, SpringNetwork::PushA });
+		});
+
+		network.Reset(graph.GetNodeCount());
+		for (uint32_t i = 0; i < springs.size(); i++)
+		{
+			const auto a = graph.GetA(i);
+			const auto b = graph.GetB(i);
+			// Springs need both ends' positions, until then they do nothing
+			const bool valid = graph.HadTransform(a) && graph.HadTransform(b);
+			network.AddSpring(a, b, springs[i].restLength, springs[i].springConstant, valid ? springs[i].flags : 0);
+		}
+		network.Build();
+	}
+
+	void SpringNetworkSystem::Draw()
+	{
+		for (uint32_t spring = 0; spring < drawnCount; spring++)
+		{
+			const auto a = network.GetA(spring);
+			const auto b = network.GetB(spring);
+			if (!graph.HadTransform(a) || !graph.HadTransform(b))
+			{
+				continue;
+			}
+
+			float g = 1.0f / (1.0f + std::pow(std::abs(network.GetStretch(spring)), 0.5f));
+			float r = (1 - g);
+			Color color = Color(r, g, 0, 1);
+			getWorld().data.renderUtil->DrawLine(network.GetPosition(b), network.GetPosition(a), color);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "ECSConfig.h"
+#include "SpringNetwork.h"
+#include "ImplicitSpringSolver.h"
+#include "ComponentGraph.h"
+#include <vector>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Applies the forces of the paired springs, bungees and fixed springs, what PairedSpringForceGeneratorSystem,
+		BungeeForceGeneratorSystem and FixedSpringForceGeneratorSystem do one spring at a time.
+
+		The springs are compiled into a SpringNetwork whose nodes are their ends. The spring components are only
+		walked, on all the threads, in steps where the world's versions say they may have changed: a spring component
+		was added, written or removed, or any entity gained or lost a component or died. Code that changes the
+		constants of existing springs outside a system that declares write access to them calls markWritten for their
+		type. The table and its per node lists are rebuilt when springs are added or removed, change ends, or an end
+		gains or loses its transform. The ends' transforms and particles are looked up in the steps the components are
+		walked and kept for the others, the forces are taken several springs at a time and every particle gets the sum
+		of its springs' forces in one AddForce. Ends that aren't particles (sleeping ones included) get no force, like
+		before.
+
+		With implicitIntegration the springs' forces are those of a backward Euler step (see ImplicitSpringSolver), so
+		stiff springs stay stable at the full fixed step. The force on each particle is the one that gives it the
+		step's velocity change, so ParticleIntegrationSystem has to integrate with the same delta time right after.
+		Other forces are still integrated explicitly on top.
+
+		Springs are drawn as one line each, colored by how far they are stretched.
+	*/
+	class SpringNetworkSystem : public ECSSystem
+	{
+	public:
+		SpringNetworkSystem();
+		void Update(float deltaTime);
+
+		bool drawSprings = true;
+		bool implicitIntegration = false;
+
+		SpringNetwork& GetNetwork() { return network; }
+		ImplicitSpringSolver& GetImplicitSolver() { return implicitSolver; }
+		int GetRebuildCount() const { return rebuildCount; }
+
+	private:
+		// Copies the constants of the spring components into the network, false if a spring was added, removed or
+		// changed ends, or an end gained or lost its transform, since the last rebuild
+		bool SyncConstants();
+		void Rebuild();
+		void Draw();
+
+		SpringNetwork network;
+		int rebuildCount = 0;
+		// Springs are the edges, in the order the views walk them: paired springs, bungees, fixed springs
+		ComponentGraph graph;
+		// Paired springs and bungees, the fixed springs after them aren't drawn
+		uint32_t drawnCount = 0;
+
+		ImplicitSpringSolver implicitSolver;
+		// 0 for nodes that aren't particles
+		std::vector<float> nodeInverseMasses;
+		std::vector<Vector3> nodeVelocities;
+	};
+}
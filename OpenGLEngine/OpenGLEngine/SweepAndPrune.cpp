@@ -0,0 +1,262 @@
+#include "SweepAndPrune.h"
+#include <algorithm>
+
+namespace Reality
+{
+	const uint32_t SweepAndPrune::NoProxy;
+
+	void SweepAndPrune::Update(const std::vector<BroadphaseSphere>& spheres)
+	{
+		frame++;
+		addedPairs.clear();
+		removedPairs.clear();
+		newProxies.clear();
+
+		for (uint32_t i = 0; i < spheres.size(); i++)
+		{
+			const auto& sphere = spheres[i];
+			if (sphere.id >= proxyOf.size())
+			{
+				proxyOf.resize(sphere.id + 1, NoProxy);
+			}
+
+			auto proxy = proxyOf[sphere.id];
+			if (proxy == NoProxy)
+			{
+				if (freeProxies.empty())
+				{
+					proxy = (uint32_t)proxies.size();
+					proxies.emplace_back();
+				}
+				else
+				{
+					proxy = freeProxies.back();
+					freeProxies.pop_back();
+				}
+				proxyOf[sphere.id] = proxy;
+				proxies[proxy].id = sphere.id;
+				proxies[proxy].isNew = true;
+				newProxies.push_back(proxy);
+			}
+
+			auto& p = proxies[proxy];
+			p.sphere = i;
+			p.frame = frame;
+			p.min = sphere.position - Vector3(sphere.radius);
+			p.max = sphere.position + Vector3(sphere.radius);
+		}
+
+		RemoveStaleProxies();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			SortAxis(axis);
+		}
+		InsertNewProxies();
+		SweepNewProxies();
+	}
+
+	void SweepAndPrune::FindPairs(std::vector<BroadphasePair>& pairs) const
+	{
+		const auto first = pairs.size();
+		for (auto key : overlappingPairs)
+		{
+			const auto a = proxies[proxyOf[(uint32_t)(key >> 32)]].sphere;
+			const auto b = proxies[proxyOf[(uint32_t)key]].sphere;
+			pairs.emplace_back(std::min(a, b), std::max(a, b));
+		}
+
+		// The set has no order, sort so the contacts come out the same way as with the other broadphases
+		std::sort(pairs.begin() + first, pairs.end());
+	}
+
+	void SweepAndPrune::RemoveStaleProxies()
+	{
+		bool removed = false;
+		for (uint32_t proxy = 0; proxy < proxies.size(); proxy++)
+		{
+			auto& p = proxies[proxy];
+			if (p.frame != 0 && p.frame != frame)
+			{
+				proxyOf[p.id] = NoProxy;
+				p.frame = 0;
+				freeProxies.push_back(proxy);
+				removed = true;
+			}
+		}
+
+		if (!removed)
+		{
+			return;
+		}
+
+		for (auto& list : endpoints)
+		{
+			list.erase(std::remove_if(list.begin(), list.end(), [this](const Endpoint& endpoint) {
+				return proxies[endpoint.GetProxy()].frame == 0;
+			}), list.end());
+		}
+
+		for (auto it = overlappingPairs.begin(); it != overlappingPairs.end();)
+		{
+			const auto idA = (uint32_t)(*it >> 32);
+			const auto idB = (uint32_t)*it;
+			if (proxyOf[idA] == NoProxy || proxyOf[idB] == NoProxy)
+			{
+				removedPairs.emplace_back(idA, idB);
+				it = overlappingPairs.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	void SweepAndPrune::SortAxis(int axis)
+	{
+		auto& list = endpoints[axis];
+		for (auto& endpoint : list)
+		{
+			const auto& p = proxies[endpoint.GetProxy()];
+			endpoint.value = endpoint.IsMax() ? p.max[axis] : p.min[axis];
+		}
+
+		// Insertion sort, nearly free when the order barely changed since the last update
+		for (std::size_t i = 1; i < list.size(); i++)
+		{
+			const auto endpoint = list[i];
+			auto j = i;
+			for (; j > 0 && endpoint.value < list[j - 1].value; j--)
+			{
+				// Overlaps only start where a start point moves below an end point, and stop where an end point moves
+				// below a start point
+				const auto& passed = list[j - 1];
+				if (!endpoint.IsMax() && passed.IsMax())
+				{
+					if (Overlaps(endpoint.GetProxy(), passed.GetProxy()))
+					{
+						AddPair(endpoint.GetProxy(), passed.GetProxy());
+					}
+				}
+				else if (endpoint.IsMax() && !passed.IsMax())
+				{
+					RemovePair(endpoint.GetProxy(), passed.GetProxy());
+				}
+				list[j] = passed;
+			}
+			list[j] = endpoint;
+		}
+	}
+
+	void SweepAndPrune::InsertNewProxies()
+	{
+		if (newProxies.empty())
+		{
+			return;
+		}
+
+		const auto isBefore = [](const Endpoint& a, const Endpoint& b) { return a.value < b.value; };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			newEndpoints.clear();
+			for (auto proxy : newProxies)
+			{
+				const auto& p = proxies[proxy];
+				newEndpoints.push_back(Endpoint{ p.min[axis], proxy << 1 });
+				newEndpoints.push_back(Endpoint{ p.max[axis], proxy << 1 | 1 });
+			}
+			std::sort(newEndpoints.begin(), newEndpoints.end(), isBefore);
+
+			auto& list = endpoints[axis];
+			const auto middle = list.size();
+			list.insert(list.end(), newEndpoints.begin(), newEndpoints.end());
+			std::inplace_merge(list.begin(), list.begin() + middle, list.end(), isBefore);
+		}
+	}
+
+	void SweepAndPrune::SweepNewProxies()
+	{
+		if (newProxies.empty())
+		{
+			return;
+		}
+
+		// Pairs of old proxies are already known, so only pairs with a new proxy are tested
+		activeOld.clear();
+		activeNew.clear();
+		for (const auto& endpoint : endpoints[0])
+		{
+			const auto proxy = endpoint.GetProxy();
+			auto& p = proxies[proxy];
+			auto& active = p.isNew ? activeNew : activeOld;
+
+			if (endpoint.IsMax())
+			{
+				const auto last = active.back();
+				active[p.activeIndex] = last;
+				proxies[last].activeIndex = p.activeIndex;
+				active.pop_back();
+				continue;
+			}
+
+			for (auto other : activeNew)
+			{
+				if (Overlaps(proxy, other))
+				{
+					AddPair(proxy, other);
+				}
+			}
+			if (p.isNew)
+			{
+				for (auto other : activeOld)
+				{
+					if (Overlaps(proxy, other))
+					{
+						AddPair(proxy, other);
+					}
+				}
+			}
+			p.activeIndex = (uint32_t)active.size();
+			active.push_back(proxy);
+		}
+
+		for (auto proxy : newProxies)
+		{
+			proxies[proxy].isNew = false;
+		}
+	}
+
+	bool SweepAndPrune::Overlaps(uint32_t a, uint32_t b) const
+	{
+		const auto& pa = proxies[a];
+		const auto& pb = proxies[b];
+		return pa.min.x < pb.max.x && pb.min.x < pa.max.x &&
+			pa.min.y < pb.max.y && pb.min.y < pa.max.y &&
+			pa.min.z < pb.max.z && pb.min.z < pa.max.z;
+	}
+
+	void SweepAndPrune::RemovePair(uint32_t a, uint32_t b)
+	{
+		const auto idA = proxies[a].id;
+		const auto idB = proxies[b].id;
+		if (overlappingPairs.erase(GetPairKey(idA, idB)) > 0)
+		{
+			removedPairs.emplace_back(std::min(idA, idB), std::max(idA, idB));
+		}
+	}
+
+	void SweepAndPrune::AddPair(uint32_t a, uint32_t b)
+	{
+		const auto idA = proxies[a].id;
+		const auto idB = proxies[b].id;
+		if (overlappingPairs.insert(GetPairKey(idA, idB)).second)
+		{
+			addedPairs.emplace_back(std::min(idA, idB), std::max(idA, idB));
+		}
+	}
+
+	uint64_t SweepAndPrune::GetPairKey(uint32_t idA, uint32_t idB)
+	{
+		return (uint64_t)std::min(idA, idB) << 32 | std::max(idA, idB);
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "SphereBroadphase.h"
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+
+namespace Reality
+{
+	/*
+		Broadphase that keeps the bounding boxes' start and end points sorted along each axis, and the set of
+		overlapping pairs, from one step to the next.
+
+		Bodies that were already there get their new bounds and the lists are insertion sorted again. When bodies move
+		only a little that is close to linear, and a pair can only start or stop overlapping where a start point passes
+		an end point, so only those swaps are checked. New bodies are sorted on their own, merged into the lists, and
+		checked against the others with one sweep along x. Bodies are told apart by their sphere id, a body whose id
+		doesn't show up in an update is removed.
+	*/
+	class SweepAndPrune : public SphereBroadphase
+	{
+	public:
+		void Update(const std::vector<BroadphaseSphere>& spheres) override;
+
+		void FindPairs(std::vector<BroadphasePair>& pairs) const override;
+
+		// Pairs that started or stopped overlapping in the last update, by sphere id
+		const std::vector<BroadphasePair>& GetAddedPairs() const { return addedPairs; }
+		const std::vector<BroadphasePair>& GetRemovedPairs() const { return removedPairs; }
+
+		std::size_t GetPairCount() const { return overlappingPairs.size(); }
+
+	private:
+		struct Proxy
+		{
+			uint32_t id;
+			uint32_t sphere;			// index in the spheres of the last update
+			uint32_t frame;				// last update the sphere was seen in, 0 for unused proxies
+			uint32_t activeIndex;		// position in the sweep's active list
+			bool isNew;					// added in this update, not in the endpoint lists yet
+			Vector3 min;
+			Vector3 max;
+		};
+
+		struct Endpoint
+		{
+			float value;
+			uint32_t data;				// proxy << 1 | 1 for an end point
+			uint32_t GetProxy() const { return data >> 1; }
+			bool IsMax() const { return (data & 1) != 0; }
+		};
+
+		void RemoveStaleProxies();
+		void SortAxis(int axis);
+		void InsertNewProxies();
+		void SweepNewProxies();
+
+		bool Overlaps(uint32_t a, uint32_t b) const;
+
+		// Both record the change if the pair wasn't / was overlapping before
+		void AddPair(uint32_t a, uint32_t b);
+		void RemovePair(uint32_t a, uint32_t b);
+
+		static uint64_t GetPairKey(uint32_t idA, uint32_t idB);
+
+		static const uint32_t NoProxy = 0xffffffffu;
+
+		std::vector<Proxy> proxies;
+		std::vector<uint32_t> freeProxies;
+		std::vector<uint32_t> newProxies;
+		// index = sphere id
+		std::vector<uint32_t> proxyOf;
+		uint32_t frame = 0;
+
+		std::vector<Endpoint> endpoints[3];
+		std::vector<Endpoint> newEndpoints;
+
+		// overlapping pairs, keyed by the two sphere ids
+		std::unordered_set<uint64_t> overlappingPairs;
+		std::vector<BroadphasePair> addedPairs;
+		std::vector<BroadphasePair> removedPairs;
+
+		// proxies whose x range contains the sweep position
+		std::vector<uint32_t> activeOld;
+		std::vector<uint32_t> activeNew;
+	};
+}